@@ -0,0 +1,76 @@
+#!/bin/sh
+#  RUNS THE PROTOCOL HEADLESS OVER TEST1-TEST3, PATH AND GENERATED TOPOLOGIES, SWEEPING THE LINK AND TRAFFIC
+#  SETTINGS, AND WRITES ONE LINE OF JSON PER RUN TO STANDARD OUTPUT, SORTED SO THAT THE OUTPUT IS STABLE.
+#
+#      bench/bench.sh [quick|full] > results.jsonl
+#
+#  quick   every topology at its own settings, then each setting varied on its own from there, one seed.
+#          This is what bench/baseline.jsonl holds and what  make bench-check  compares against.
+#  full    every combination of the settings below on TEST1-TEST3, three seeds
+#
+#  Runs fan out over every core with xargs -P; JOBS, SECONDS_RUN and SIM override the defaults, and any
+#  further arguments are passed to every run (e.g.  -o arqmode=gobackn -o windowsize=4).
+
+PROFILE=${1:-quick}
+[ $# -gt 0 ] && shift
+EXTRA="$*"
+
+SIM=${SIM:-./sim/cnetsim}
+JOBS=${JOBS:-$(nproc 2>/dev/null || echo 4)}
+SECONDS_RUN=${SECONDS_RUN:-3600}
+GEN=bench/gen
+
+BANDWIDTHS="56Kbps 1Mbps 10Mbps"
+DELAYS="10ms 100ms 1500ms"
+LOSSES="0 3 6"
+CORRUPTS="0 3 6"
+SIZES="64 1000 4000"
+
+mkdir -p $GEN
+for shape in chain:8 ring:12 star:16 grid:16 mesh:20; do
+    kind=${shape%:*}
+    n=${shape#*:}
+    awk -v kind=$kind -v n=$n -v seed=1 -f bench/gentopo.awk > $GEN/$kind$n
+done
+
+#  ONE LINE OF cnetsim ARGUMENTS PER RUN
+runs()
+{
+    case $PROFILE in
+    quick)
+        for t in TEST1 TEST2 TEST3 PATH $GEN/chain8 $GEN/ring12 $GEN/star16 $GEN/grid16 $GEN/mesh20; do
+            echo "$t"
+            for b in $BANDWIDTHS; do echo "$t -o bandwidth=$b"; done
+            for d in $DELAYS; do echo "$t -o propagationdelay=$d"; done
+            for l in $LOSSES; do echo "$t -o probframeloss=$l"; done
+            for c in $CORRUPTS; do echo "$t -o probframecorrupt=$c"; done
+            for s in $SIZES; do echo "$t -o minmessagesize=$s -o maxmessagesize=$s"; done
+        done | awk '{ print "-s 1", $0 }'
+        ;;
+    full)
+        for t in TEST1 TEST2 TEST3; do
+        for b in $BANDWIDTHS; do
+        for d in $DELAYS; do
+        for l in $LOSSES; do
+        for c in $CORRUPTS; do
+        for s in $SIZES; do
+        for seed in 1 2 3; do
+            echo "-s $seed $t -o bandwidth=$b -o propagationdelay=$d -o probframeloss=$l -o probframecorrupt=$c -o minmessagesize=$s -o maxmessagesize=$s"
+        done; done; done; done; done; done; done
+        ;;
+    *)
+        echo "usage: $0 [quick|full] [cnetsim options...]" >&2
+        exit 2
+        ;;
+    esac
+}
+
+#  THE TOPOLOGY MUST COME LAST ON cnetsim'S COMMAND LINE, SO MOVE IT THERE. A RUN'S DELIVERY ERRORS ARE IN ITS
+#  JSON, SO ITS COMPLAINTS ON STANDARD ERROR ARE DROPPED
+runs | awk -v extra="$EXTRA" -v secs="$SECONDS_RUN" '{
+        topology = $3
+        $3 = ""
+        print "-q -j -T", secs, extra, $0, topology
+    }' |
+    SIM="$SIM" xargs -P "$JOBS" -L 1 sh -c '"$SIM" "$@" 2>/dev/null; true' cnetsim |
+    sort
@@ -0,0 +1,97 @@
+#!/bin/sh
+#  COMPARES BENCHMARK RESULTS WITH A STORED BASELINE, RUN BY RUN, AND FAILS IF ANY RUN LOST MORE THAN TOLERANCE
+#  (DEFAULT 5%) OF ITS GOODPUT, OR GAINED MORE THAN THAT IN RETRANSMISSION RATIO, p50/p99 LATENCY OR MESSAGES
+#  NEVER DELIVERED, OR DELIVERED A SINGLE MESSAGE WRONGLY, WHATEVER THE BASELINE SAYS.
+#
+#  AS THE BASELINE MOVES WITH EVERY ACCEPTED CHANGE, TWO FLOORS HOLD WHATEVER IT SAYS, OF LINK UTILIZATION AS A
+#  FRACTION OF STOP-AND-WAIT'S LOSS-FREE CEILING u_theory: RUN_FLOOR (DEFAULT 0.02) FOR EVERY RUN, SO THAT NONE
+#  CAN ALL BUT STOP, AND SWEEP_FLOOR (DEFAULT 0.6) FOR THE GEOMETRIC MEAN OVER ALL THE RUNS.
+#
+#      bench/check.sh bench/baseline.jsonl results.jsonl
+#
+#  The simulator is deterministic, so any difference at all comes from the protocol or the simulator.
+
+BASELINE=${1:?usage: $0 baseline.jsonl results.jsonl}
+RESULTS=${2:?usage: $0 baseline.jsonl results.jsonl}
+
+awk -v tolerance="${TOLERANCE:-0.05}" -v runfloor="${RUN_FLOOR:-0.02}" -v sweepfloor="${SWEEP_FLOOR:-0.6}" '
+    function field(line, name,    rest)
+    {
+        if(!match(line, "\"" name "\":"))
+            return ""
+        rest = substr(line, RSTART + RLENGTH)
+        if(substr(rest, 1, 1) == "\"")
+        {
+            rest = substr(rest, 2)
+            return substr(rest, 1, index(rest, "\"") - 1)
+        }
+        match(rest, /^[-0-9.e]+/)
+        return substr(rest, 1, RLENGTH) + 0
+    }
+    function key(line)
+    {
+        return field(line, "topology") " seed=" field(line, "seed") " " field(line, "overrides")
+    }
+    #  RELATIVE CHANGE, OR THE ABSOLUTE ONE WHERE THE BASELINE IS ZERO
+    function change(was, now)
+    {
+        return was != 0 ? (now - was) / was : now - was
+    }
+    function worse(run, metric, delta, was, now)
+    {
+        printf "REGRESSION  %-60s %-16s %12.4f -> %12.4f  (%+.1f%%)\n", run, metric, was, now, 100*delta
+        failed++
+    }
+
+    FNR == NR {
+        baseline[key($0)] = $0
+        next
+    }
+    {
+        run = key($0)
+        runs++
+        #  UNDER HEAVY LOSS SOME CONNECTIONS STALL FOR GOOD, SO ONLY UNDELIVERED MESSAGES MAY BE IN THE BASELINE
+        wrong = field($0, "errors") - field($0, "undelivered")
+        if(wrong > 0)
+            worse(run, "errors", wrong, 0, wrong)
+        if(field($0, "u_theory") > 0)
+        {
+            u = field($0, "link_utilization") / field($0, "u_theory")
+            if(u < runfloor)
+                worse(run, "util/u_theory", change(runfloor, u), runfloor, u)
+            logu += log(u > 0 ? u : 1e-9)
+            nu++
+        }
+        if(!(run in baseline))
+        {
+            printf "NEW         %s\n", run
+            next
+        }
+        was = baseline[run]
+        seen[run] = 1
+
+        d = change(field(was, "goodput_bps"), field($0, "goodput_bps"))
+        if(d < -tolerance)
+            worse(run, "goodput_bps", d, field(was, "goodput_bps"), field($0, "goodput_bps"))
+        else if(d > tolerance)
+            better++
+
+        for(m = 1; m <= 4; m++)
+        {
+            metric = m == 1 ? "retx_ratio" : m == 2 ? "latency_p50_ms" : m == 3 ? "latency_p99_ms" : "undelivered"
+            if(field(was, metric) == "")
+                continue
+            d = change(field(was, metric), field($0, metric))
+            if(d > tolerance && field($0, metric) - field(was, metric) > 1e-3)
+                worse(run, metric, d, field(was, metric), field($0, metric))
+        }
+    }
+    END {
+        if(nu > 0 && exp(logu / nu) < sweepfloor)
+            worse("all runs, geometric mean", "util/u_theory", change(sweepfloor, exp(logu / nu)), sweepfloor, exp(logu / nu))
+        for(run in baseline)
+            if(!(run in seen))
+                printf "MISSING     %s\n", run
+        printf "%i runs compared, %i regressions, %i with goodput up by more than %g%%\n", runs, failed, better, 100*tolerance
+        exit failed > 0
+    }' "$BASELINE" "$RESULTS"
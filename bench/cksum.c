@@ -0,0 +1,117 @@
+//  MICROBENCHMARK OF THE FRAME CHECKSUMS IN checksum.c AGAINST THE BITWISE CRC-16 THAT CNET_ccitt COMPUTES,
+//  OVER FRAME SIZES FROM A PURE ACK TO A FULL MESSAGE. EVERY CRC-16 MUST AGREE WITH THE BITWISE ONE, AND
+//  BOTH CRC-32Cs WITH EACH OTHER, ON RANDOM DATA OF EVERY LENGTH UP TO 64 BYTES AND ON THE FRAMES TIMED.
+//
+//      bench/cksum [seconds per measurement, default 0.2]
+
+#include "../checksum.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_FRAME           8192
+
+//  ONE BIT AT A TIME, THE TEXTBOOK CRC-16 WITH POLYNOMIAL 0x1021 AND NO INVERSION
+static uint32_t ccitt_bitwise(uint32_t sum, const unsigned char *p, size_t n)
+{
+    uint16_t crc = sum;
+
+    while(n--)
+    {
+        crc ^= *p++ << 8;
+        for(int bit = 0; bit < 8; bit++)
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+typedef struct {
+    const char  *name;
+    CHECKSUMFN  fn;
+    CHECKSUMFN  reference;
+} CANDIDATE;
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int verify(CANDIDATE *c, unsigned char *data)
+{
+    static const unsigned char check[] = "123456789";
+    int failed = 0;
+
+    for(size_t n = 0; n <= 64; n++)
+    {
+        for(size_t offset = 0; offset < 8; offset++)
+        {
+            if(c->fn(0, data + offset, n) != c->reference(0, data + offset, n))
+                failed++;
+        }
+    }
+//  SPLIT ANYWHERE, TWO CALLS MUST GIVE WHAT ONE CALL OVER THE WHOLE DOES
+    for(size_t split = 0; split <= 64; split += 7)
+    {
+        if(c->fn(c->fn(0, data, split), data + split, MAX_FRAME - split) != c->reference(0, data, MAX_FRAME))
+            failed++;
+    }
+    if(failed)
+        printf("%-22s DISAGREES on %i inputs\n", c->name, failed);
+    printf("%-22s check(\"123456789\")= 0x%04x\n", c->name, c->fn(0, check, 9));
+    return failed;
+}
+
+int main(int argc, char **argv)
+{
+    double          budget = argc > 1 ? atof(argv[1]) : 0.2;
+    unsigned char   *data = malloc(MAX_FRAME + 8);
+    size_t          sizes[] = { 10, 64, 1500, MAX_FRAME };
+    int             failed = 0;
+    CANDIDATE       candidates[] = {
+        { "bitwise (CNET_ccitt)",   ccitt_bitwise,  ccitt_bitwise },
+        { "crc16-bytewise",         crc16_bytewise, ccitt_bitwise },
+        { "crc16 (slice-by-8)",     crc16_slice8,   ccitt_bitwise },
+        { "crc32c slice-by-8",      crc32c_slice8,  crc32c_slice8 },
+        { "crc32c sse4.2",          crc32c_sse42,   crc32c_slice8 },
+    };
+    int             ncandidates = sizeof(candidates) / sizeof(candidates[0]) - (crc32c_hardware() ? 0 : 1);
+
+    srand(1);
+    for(int i = 0; i < MAX_FRAME + 8; i++)
+        data[i] = rand();
+    for(int c = 0; c < ncandidates; c++)
+        failed += verify(&candidates[c], data);
+
+    printf("\n%-22s", "MB/s (ns per frame)");
+    for(int s = 0; s < 4; s++)
+        printf("  %18zu", sizes[s]);
+    printf("\n");
+
+    for(int c = 0; c < ncandidates; c++)
+    {
+        printf("%-22s", candidates[c].name);
+        for(int s = 0; s < 4; s++)
+        {
+            volatile uint32_t   sink = 0;
+            long                calls = 0;
+            double              started = now(), elapsed;
+
+//  CHECK THE CLOCK ONLY EVERY 1024 CALLS, SO THAT IT DOES NOT DOMINATE THE SMALL FRAMES
+            do
+            {
+                for(int i = 0; i < 1024; i++)
+                    sink ^= candidates[c].fn(0, data, sizes[s]);
+                calls += 1024;
+            } while((elapsed = now() - started) < budget);
+            printf("  %8.0f (%7.1f)", calls * sizes[s] / elapsed / 1e6, elapsed / calls * 1e9);
+        }
+        printf("\n");
+    }
+    if(!crc32c_hardware())
+        printf("(no SSE4.2, crc32c runs slice-by-8)\n");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,66 @@
+#!/bin/sh
+#  FORWARD ERROR CORRECTION AGAINST SELECTIVE REPEAT ALONE, AT THE LOSS AND CORRUPTION OF TEST1-TEST3: EVERY
+#  TOPOLOGY WITH  var fec = "none", "xor"  AND  "rs", OVER THREE SEEDS, PRINTING THE MEAN OF EACH. FAILS IF ANY
+#  RUN DELIVERED A MESSAGE WRONGLY.
+#
+#      bench/fec.sh [cnetsim options...]
+#
+#  The options default to  -o windowsize=4. JOBS, SECONDS_RUN and SIM override the defaults as in bench/bench.sh.
+
+SIM=${SIM:-./sim/cnetsim}
+JOBS=${JOBS:-$(nproc 2>/dev/null || echo 4)}
+SECONDS_RUN=${SECONDS_RUN:-1800}
+EXTRA=${*:--o windowsize=4}
+
+for t in TEST1 TEST2 TEST3; do
+    for f in none xor rs; do
+        for seed in 1 2 3; do
+            echo "-q -j -T $SECONDS_RUN -s $seed -o arqmode=selectiverepeat -o fec=$f $EXTRA $t"
+        done
+    done
+done |
+    SIM="$SIM" xargs -P "$JOBS" -L 1 sh -c '"$SIM" "$@" 2>/dev/null; true' cnetsim |
+    awk '
+    function field(line, name,    rest)
+    {
+        if(!match(line, "\"" name "\":"))
+            return ""
+        rest = substr(line, RSTART + RLENGTH)
+        if(substr(rest, 1, 1) == "\"")
+        {
+            rest = substr(rest, 2)
+            return substr(rest, 1, index(rest, "\"") - 1)
+        }
+        match(rest, /^[-0-9.e]+/)
+        return substr(rest, 1, RLENGTH) + 0
+    }
+    {
+        overrides = field($0, "overrides")
+        match(overrides, /fec=[a-z]+/)
+        code = substr(overrides, RSTART + 4, RLENGTH - 4)
+        run = field($0, "topology") " " code
+        runs[run]++
+        delivered[run]  += field($0, "delivered")
+        errors[run]     += field($0, "errors")
+        failed          += field($0, "errors") > 0
+        goodput[run]    += field($0, "goodput_bps")
+        mean[run]       += field($0, "latency_mean_ms")
+        p50[run]        += field($0, "latency_p50_ms")
+        p95[run]        += field($0, "latency_p95_ms")
+    }
+    END {
+        printf "%-12s %10s %7s %12s %12s %12s %12s\n", "", "delivered", "errors", "goodput bps", "latency s", "p50 s", "p95 s"
+        for(t = 1; t <= 3; t++)
+        {
+            for(f = 1; f <= 3; f++)
+            {
+                run = "TEST" t " " (f == 1 ? "none" : f == 2 ? "xor" : "rs")
+                if(!(run in runs))
+                    continue
+                n = runs[run]
+                printf "%-12s %10.0f %7i %12.0f %12.1f %12.1f %12.1f\n", run, delivered[run] / n, errors[run],
+                       goodput[run] / n, mean[run] / n / 1000, p50[run] / n / 1000, p95[run] / n / 1000
+            }
+        }
+        exit failed > 0
+    }'
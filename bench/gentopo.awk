@@ -0,0 +1,113 @@
+#  WRITES A CNET TOPOLOGY FILE OF A GIVEN SHAPE AND SIZE, WITH THE SAME LINK AND TRAFFIC SETTINGS AS TEST1-TEST3
+#
+#      awk -v kind=chain -v n=8 [-v seed=1] -f bench/gentopo.awk > chain8
+#
+#  chain   two hosts at the ends of n-2 routers in a line
+#  ring    n hosts in a ring, relaying for each other
+#  star    n hosts around one router
+#  grid    sqrt(n) x sqrt(n) routers, with a host on every router of the first and last columns
+#  mesh    n routers joined by a random spanning tree plus n/2 random extra links, a host on every other router
+
+function link(a, b)
+{
+    links[a] = links[a] ", link to " b
+}
+
+function node(type, name, x, y)
+{
+    printf "%s %s { x= %i, y= %i%s }\n", type, name, x, y, links[name]
+}
+
+BEGIN {
+    if(n < 2)
+        n = 8
+    srand(seed ? seed : 1)
+
+    print "compile          = \"stopandwait.c\"\n"
+    print "bandwidth        = 56 Kbps\n"
+    print "minmessagesize   = 1000 bytes"
+    print "maxmessagesize   = 2000 bytes\n"
+    print "messagerate      = 300 ms"
+    print "propagationdelay = 1500 ms\n"
+    print "probframeloss    = 3"
+    print "probframecorrupt = 3\n"
+
+    if(kind == "chain")
+    {
+        for(i = 1; i < n - 1; i++)
+            link("r" i, i == 1 ? "h0" : "r" (i - 1))
+        link("h1", n > 2 ? "r" (n - 2) : "h0")
+        node("host", "h0", 50, 50)
+        for(i = 1; i < n - 1; i++)
+            node("router", "r" i, 50 + 75*i, 50)
+        node("host", "h1", 50 + 75*(n - 1), 50)
+    }
+    else if(kind == "ring")
+    {
+        for(i = 0; i < n; i++)
+            link("h" i, "h" ((i + 1) % n))
+        for(i = 0; i < n; i++)
+            node("host", "h" i, 300 + 200*cos(6.2832*i/n), 300 + 200*sin(6.2832*i/n))
+    }
+    else if(kind == "star")
+    {
+        for(i = 0; i < n; i++)
+            link("h" i, "hub")
+        node("router", "hub", 300, 300)
+        for(i = 0; i < n; i++)
+            node("host", "h" i, 300 + 200*cos(6.2832*i/n), 300 + 200*sin(6.2832*i/n))
+    }
+    else if(kind == "grid")
+    {
+        k = int(sqrt(n) + 0.5)
+        for(r = 0; r < k; r++)
+            for(c = 0; c < k; c++)
+            {
+                if(c > 0)
+                    link("r" r "_" c, "r" r "_" (c - 1))
+                if(r > 0)
+                    link("r" r "_" c, "r" (r - 1) "_" c)
+                if(c == 0 || c == k - 1)
+                    link("h" r "_" c, "r" r "_" c)
+            }
+        for(r = 0; r < k; r++)
+            for(c = 0; c < k; c++)
+            {
+                node("router", "r" r "_" c, 100 + 100*c, 100 + 100*r)
+                if(c == 0 || c == k - 1)
+                    node("host", "h" r "_" c, c == 0 ? 25 : 175 + 100*c, 100 + 100*r)
+            }
+    }
+    else if(kind == "mesh")
+    {
+        for(i = 1; i < n; i++)
+        {
+            j = int(rand() * i)
+            link("r" i, "r" j)
+            joined[i, j] = joined[j, i] = 1
+        }
+        for(extra = 0; extra < n / 2; )
+        {
+            i = int(rand() * n)
+            j = int(rand() * n)
+            if(i == j || ((i, j) in joined))
+                continue
+            link("r" i, "r" j)
+            joined[i, j] = joined[j, i] = 1
+            extra++
+        }
+        for(i = 0; i < n; i += 2)
+            link("h" i, "r" i)
+        for(i = 0; i < n; i++)
+        {
+            node("router", "r" i, 50 + 500*rand(), 50 + 500*rand())
+            if(i % 2 == 0)
+                node("host", "h" i, 50 + 500*rand(), 50 + 500*rand())
+        }
+    }
+    else
+    {
+        print "gentopo.awk: kind must be chain, ring, star, grid or mesh" > "/dev/stderr"
+        exit 2
+    }
+}
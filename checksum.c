@@ -0,0 +1,170 @@
+//  TABLE-DRIVEN AND SLICE-BY-8 CRCS FOR THE FRAME CHECKSUMS, SEE checksum.h.
+//
+//  SLICE-BY-8 KEEPS EIGHT TABLES, TABLE k HOLDING THE CRC OF A BYTE FOLLOWED BY k ZERO BYTES, SO THAT EIGHT
+//  BYTES OF INPUT COST EIGHT INDEPENDENT LOOKUPS RATHER THAN A CHAIN OF EIGHT DEPENDENT ONES. THE TABLES
+//  ARE BUILT ON FIRST USE
+
+#include "checksum.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define HAVE_SSE42_BUILTIN
+#endif
+
+#define CRC16_POLY          0x1021
+#define CRC32C_POLY         0x82F63B78      // reflected
+
+static uint16_t     crc16table[8][256];
+static uint32_t     crc32ctable[8][256];
+static bool         tablesbuilt = false;
+
+static void build_tables(void)
+{
+    for(int b = 0; b < 256; b++)
+    {
+        uint16_t    c16 = b << 8;
+        uint32_t    c32 = b;
+
+        for(int bit = 0; bit < 8; bit++)
+        {
+            c16 = c16 & 0x8000 ? (c16 << 1) ^ CRC16_POLY : c16 << 1;
+            c32 = c32 & 1 ? (c32 >> 1) ^ CRC32C_POLY : c32 >> 1;
+        }
+        crc16table[0][b]    = c16;
+        crc32ctable[0][b]   = c32;
+    }
+    for(int k = 1; k < 8; k++)
+    {
+        for(int b = 0; b < 256; b++)
+        {
+            uint16_t prev16 = crc16table[k-1][b];
+            uint32_t prev32 = crc32ctable[k-1][b];
+
+            crc16table[k][b]    = (prev16 << 8) ^ crc16table[0][prev16 >> 8];
+            crc32ctable[k][b]   = (prev32 >> 8) ^ crc32ctable[0][prev32 & 0xff];
+        }
+    }
+    tablesbuilt = true;
+}
+
+uint32_t crc16_bytewise(uint32_t sum, const unsigned char *p, size_t n)
+{
+    uint16_t crc = sum;
+
+    if(!tablesbuilt)
+        build_tables();
+    while(n--)
+        crc = (crc << 8) ^ crc16table[0][(crc >> 8) ^ *p++];
+    return crc;
+}
+
+uint32_t crc16_slice8(uint32_t sum, const unsigned char *p, size_t n)
+{
+    uint16_t crc = sum;
+
+    if(!tablesbuilt)
+        build_tables();
+//  THE CRC IS FOLDED INTO THE FIRST TWO BYTES, THE OTHER SIX ONLY ADD THEIR OWN CONTRIBUTION
+    for(; n >= 8; p += 8, n -= 8)
+    {
+        crc = crc16table[7][p[0] ^ (crc >> 8)] ^ crc16table[6][p[1] ^ (crc & 0xff)] ^
+              crc16table[5][p[2]] ^ crc16table[4][p[3]] ^ crc16table[3][p[4]] ^
+              crc16table[2][p[5]] ^ crc16table[1][p[6]] ^ crc16table[0][p[7]];
+    }
+    while(n--)
+        crc = (crc << 8) ^ crc16table[0][(crc >> 8) ^ *p++];
+    return crc;
+}
+
+uint32_t crc32c_slice8(uint32_t sum, const unsigned char *p, size_t n)
+{
+    uint32_t crc = ~sum;
+
+    if(!tablesbuilt)
+        build_tables();
+    for(; n >= 8; p += 8, n -= 8)
+    {
+        uint32_t lo = crc ^ (p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24);
+
+        crc = crc32ctable[7][lo & 0xff] ^ crc32ctable[6][(lo >> 8) & 0xff] ^
+              crc32ctable[5][(lo >> 16) & 0xff] ^ crc32ctable[4][lo >> 24] ^
+              crc32ctable[3][p[4]] ^ crc32ctable[2][p[5]] ^ crc32ctable[1][p[6]] ^ crc32ctable[0][p[7]];
+    }
+    while(n--)
+        crc = (crc >> 8) ^ crc32ctable[0][(crc ^ *p++) & 0xff];
+    return ~crc;
+}
+
+#ifdef HAVE_SSE42_BUILTIN
+//  THE 8-BYTE CRC32 INSTRUCTION ONLY EXISTS IN 64-BIT MODE, SO ON i386 THE LOOP TAKES 4 BYTES AT A TIME
+__attribute__((target("sse4.2")))
+uint32_t crc32c_sse42(uint32_t sum, const unsigned char *p, size_t n)
+{
+#if defined(__x86_64__)
+    uint64_t crc = ~sum;
+
+    for(; n >= 8; p += 8, n -= 8)
+    {
+        uint64_t word;
+
+        memcpy(&word, p, 8);        // x86 is little-endian, as the CRC's bit order wants
+        crc = _mm_crc32_u64(crc, word);
+    }
+#else
+    uint32_t crc = ~sum;
+
+    for(; n >= 4; p += 4, n -= 4)
+    {
+        uint32_t word;
+
+        memcpy(&word, p, 4);
+        crc = _mm_crc32_u32(crc, word);
+    }
+#endif
+    while(n--)
+        crc = _mm_crc32_u8(crc, *p++);
+    return ~(uint32_t)crc;
+}
+
+bool crc32c_hardware(void)
+{
+    static int hardware = -1;
+
+    if(hardware == -1)
+        hardware = __builtin_cpu_supports("sse4.2") != 0;
+    return hardware;
+}
+#else
+uint32_t crc32c_sse42(uint32_t sum, const unsigned char *p, size_t n)
+{
+    return crc32c_slice8(sum, p, n);
+}
+
+bool crc32c_hardware(void)
+{
+    return false;
+}
+#endif
+
+uint32_t crc32c(uint32_t sum, const unsigned char *p, size_t n)
+{
+    return crc32c_hardware() ? crc32c_sse42(sum, p, n) : crc32c_slice8(sum, p, n);
+}
+
+const CHECKSUM checksums[] = {
+    { "crc16",          2,  crc16_slice8    },
+    { "crc16-bytewise", 2,  crc16_bytewise  },
+    { "crc32c",         4,  crc32c          },
+    { NULL,             0,  NULL            }
+};
+
+const CHECKSUM *checksum_find(const char *name)
+{
+    for(const CHECKSUM *c = checksums; c->name != NULL; c++)
+    {
+        if(strcmp(c->name, name) == 0)
+            return c;
+    }
+    return NULL;
+}
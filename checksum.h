@@ -0,0 +1,33 @@
+//  THE FRAME CHECKSUMS, SELECTED PER TOPOLOGY FILE WITH  var checksum = "crc32c". EVERY FUNCTION CONTINUES
+//  THE CHECKSUM sum OF WHAT CAME BEFORE, 0 TO START, SO THAT ONE CHECKSUM CAN COVER SEVERAL PIECES OF A FRAME
+#ifndef _CHECKSUM_H_
+#define _CHECKSUM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef uint32_t (*CHECKSUMFN)(uint32_t sum, const unsigned char *p, size_t n);
+
+typedef struct {
+    const char  *name;
+    int         bytes;          // on the wire
+    CHECKSUMFN  fn;
+} CHECKSUM;
+
+//  THE CHOICES, ENDING WITH A NULL name. THE FIRST IS THE DEFAULT
+extern const CHECKSUM   checksums[];
+
+extern const CHECKSUM   *checksum_find(const char *name);
+
+//  CRC-16/XMODEM (POLYNOMIAL 0x1021, MSB FIRST, NO INVERSION), ONE TABLE LOOKUP PER BYTE OR PER 8 BYTES
+extern uint32_t         crc16_bytewise(uint32_t sum, const unsigned char *p, size_t n);
+extern uint32_t         crc16_slice8(uint32_t sum, const unsigned char *p, size_t n);
+
+//  CRC-32C (CASTAGNOLI), WITH SSE4.2's crc32 INSTRUCTION WHERE THE CPU HAS IT AND SLICE-BY-8 OTHERWISE
+extern uint32_t         crc32c(uint32_t sum, const unsigned char *p, size_t n);
+extern uint32_t         crc32c_slice8(uint32_t sum, const unsigned char *p, size_t n);
+extern bool             crc32c_hardware(void);
+extern uint32_t         crc32c_sse42(uint32_t sum, const unsigned char *p, size_t n);
+
+#endif
@@ -0,0 +1,161 @@
+//  XOR PARITY AND REED-SOLOMON ERASURE CODES FOR FORWARD ERROR CORRECTION, SEE fec.h.
+//
+//  THE REED-SOLOMON CODE IS SYSTEMATIC WITH A CAUCHY GENERATOR: PARITY ROW j WEIGHTS DATA SYMBOL i BY
+//  1 / (x_j + y_i) WITH y_i = i AND x_j = FEC_MAX_DATA + j, ALL DISTINCT, AND EVERY SQUARE SUBMATRIX OF A
+//  CAUCHY MATRIX IS INVERTIBLE, SO ANY e PARITY SYMBOLS REBUILD ANY e MISSING DATA SYMBOLS. XOR PARITY IS
+//  THE SINGLE ROW OF ALL ONES. GF(256) IS MULTIPLIED BY LOG AND EXP TABLES, BUILT ON FIRST USE
+
+#include "fec.h"
+#include <string.h>
+
+#define GF_POLY             0x11d           // x^8 + x^4 + x^3 + x^2 + 1
+
+static unsigned char    gflog[256];
+static unsigned char    gfexp[512];         // doubled, so a sum of two logs needs no reduction
+static bool             tablesbuilt = false;
+
+static void build_tables(void)
+{
+    int x = 1;
+
+    for(int i = 0; i < 255; i++)
+    {
+        gfexp[i] = gfexp[i + 255] = x;
+        gflog[x] = i;
+        x <<= 1;
+        if(x & 0x100)
+            x ^= GF_POLY;
+    }
+    tablesbuilt = true;
+}
+
+static unsigned char gf_mul(unsigned char a, unsigned char b)
+{
+    return a == 0 || b == 0 ? 0 : gfexp[gflog[a] + gflog[b]];
+}
+
+static unsigned char gf_inv(unsigned char a)
+{
+    return gfexp[255 - gflog[a]];
+}
+
+static unsigned char coefficient(FECCODE code, int row, int i)
+{
+    return code == FEC_XOR ? 1 : gf_inv((FEC_MAX_DATA + row) ^ i);
+}
+
+//  out[b] ^= c * in[b] FOR THE FIRST n BYTES, THE INNER LOOP OF BOTH ENCODING AND DECODING
+static void add_scaled(unsigned char *out, const unsigned char *in, unsigned char c, size_t n)
+{
+    if(c == 0)
+        return;
+    if(c == 1)
+    {
+        for(size_t b = 0; b < n; b++)
+            out[b] ^= in[b];
+        return;
+    }
+
+    const unsigned char *row = &gfexp[gflog[c]];
+
+    for(size_t b = 0; b < n; b++)
+    {
+        if(in[b])
+            out[b] ^= row[gflog[in[b]]];
+    }
+}
+
+void fec_encode(FECCODE code, int row, unsigned char *const data[], const size_t lengths[], int n,
+                unsigned char *parity, size_t length)
+{
+    if(!tablesbuilt)
+        build_tables();
+    memset(parity, 0, length);
+    for(int i = 0; i < n; i++)
+        add_scaled(parity, data[i], coefficient(code, row, i), lengths[i] < length ? lengths[i] : length);
+}
+
+bool fec_decode(FECCODE code, unsigned char *const data[], const size_t lengths[], const bool missing[], int n,
+                unsigned char *const parity[], const int rows[], int nparity, size_t length)
+{
+    int             lost[FEC_MAX_PARITY];
+    int             e = 0;
+    unsigned char   a[FEC_MAX_PARITY][2 * FEC_MAX_PARITY];
+
+    for(int i = 0; i < n; i++)
+    {
+        if(missing[i])
+        {
+            if(e == nparity || e == FEC_MAX_PARITY)
+                return false;
+            lost[e++] = i;
+        }
+    }
+    if(e == 0)
+        return true;
+    if(code == FEC_XOR && e > 1)
+        return false;
+    if(!tablesbuilt)
+        build_tables();
+
+//  INVERT THE e BY e SUBMATRIX OF THE ROWS USED AND THE COLUMNS LOST, BY GAUSS-JORDAN ON [ A | I ]
+    for(int r = 0; r < e; r++)
+    {
+        for(int c = 0; c < e; c++)
+        {
+            a[r][c]     = coefficient(code, rows[r], lost[c]);
+            a[r][e + c] = r == c;
+        }
+    }
+    for(int c = 0; c < e; c++)
+    {
+        int pivot = c;
+
+        while(a[pivot][c] == 0)             // a Cauchy matrix always has one
+            pivot++;
+        for(int k = 0; k < 2 * e; k++)
+        {
+            unsigned char t = a[c][k];
+
+            a[c][k] = a[pivot][k];
+            a[pivot][k] = t;
+        }
+
+        unsigned char scale = gf_inv(a[c][c]);
+
+        for(int k = 0; k < 2 * e; k++)
+            a[c][k] = gf_mul(a[c][k], scale);
+        for(int r = 0; r < e; r++)
+        {
+            unsigned char f = a[r][c];
+
+            if(r != c && f != 0)
+            {
+                for(int k = 0; k < 2 * e; k++)
+                    a[r][k] ^= gf_mul(f, a[c][k]);
+            }
+        }
+    }
+
+//  THE SYNDROME OF EACH PARITY ROW IS ITS PARITY LESS WHAT THE DATA RECEIVED CONTRIBUTED, LEAVING ONLY THE
+//  LOST SYMBOLS' CONTRIBUTION. THE LOST SYMBOLS ARE THE INVERSE TIMES THE SYNDROMES
+    unsigned char syndrome[e][length ? length : 1];
+
+    for(int r = 0; r < e; r++)
+    {
+        memcpy(syndrome[r], parity[r], length);
+        for(int i = 0; i < n; i++)
+        {
+            if(!missing[i])
+                add_scaled(syndrome[r], data[i], coefficient(code, rows[r], i),
+                           lengths[i] < length ? lengths[i] : length);
+        }
+    }
+    for(int c = 0; c < e; c++)
+    {
+        memset(data[lost[c]], 0, length);
+        for(int r = 0; r < e; r++)
+            add_scaled(data[lost[c]], syndrome[r], a[c][e + r], length);
+    }
+    return true;
+}
@@ -0,0 +1,25 @@
+//  ERASURE CODES FOR FORWARD ERROR CORRECTION, SELECTED PER TOPOLOGY FILE WITH  var fec = "xor"  OR  "rs".
+//  A BLOCK IS n DATA SYMBOLS AND SOME PARITY SYMBOLS, EACH PARITY BYTE A LINEAR COMBINATION OVER GF(256) OF THE
+//  DATA BYTES AT THE SAME OFFSET. A DATA SYMBOL SHORTER THAN THE BLOCK COUNTS AS PADDED WITH ZEROS
+#ifndef _FEC_H_
+#define _FEC_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef enum { FEC_NONE, FEC_XOR, FEC_RS } FECCODE;
+
+#define FEC_MAX_DATA        8
+#define FEC_MAX_PARITY      4
+
+//  PARITY SYMBOL row (ALWAYS 0 FOR FEC_XOR) OF THE n DATA SYMBOLS data[i] OF lengths[i] BYTES, length BYTES LONG
+extern void fec_encode(FECCODE code, int row, unsigned char *const data[], const size_t lengths[], int n,
+                       unsigned char *parity, size_t length);
+
+//  REBUILD THE DATA SYMBOLS MARKED missing, INTO THE length-BYTE BUFFERS data[i] POINTS TO, FROM THE PARITY
+//  SYMBOLS parity[r] OF ROWS rows[r]. ONE PARITY SYMBOL REBUILDS ONE MISSING DATA SYMBOL, AND FEC_XOR HAS ONLY
+//  ONE. RETURNS FALSE, CHANGING NOTHING, IF THERE ARE TOO FEW
+extern bool fec_decode(FECCODE code, unsigned char *const data[], const size_t lengths[], const bool missing[], int n,
+                       unsigned char *const parity[], const int rows[], int nparity, size_t length);
+
+#endif
@@ -0,0 +1,80 @@
+//  THE SUBSET OF THE CNET API THAT stopandwait.c USES, AS PROVIDED BY THE HEADLESS SIMULATOR IN sim.c.
+//  THE NAMES, TYPES AND CALLING CONVENTIONS FOLLOW CNET'S OWN <cnet.h>, SO THE PROTOCOL COMPILES
+//  UNCHANGED AGAINST EITHER
+#ifndef _CNET_H_
+#define _CNET_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define MAX_MESSAGE_SIZE    8192
+
+typedef int         CnetAddr;
+typedef int64_t     CnetTime;               // always in usec
+typedef long        CnetTimerID;
+typedef long        CnetData;
+
+#define NULLTIMER           0
+#define ALLNODES            (-1)
+
+typedef enum { NT_HOST, NT_ROUTER } CnetNodeType;
+
+typedef enum {
+    EV_NULL, EV_REBOOT, EV_SHUTDOWN, EV_APPLICATIONREADY, EV_PHYSICALREADY,
+    EV_DEBUG0, EV_DEBUG1,
+    EV_TIMER0, EV_TIMER1, EV_TIMER2, EV_TIMER3, EV_TIMER4, EV_TIMER5,
+    EV_TIMER6, EV_TIMER7, EV_TIMER8, EV_TIMER9, EV_TIMER10,
+    N_CNET_EVENTS
+} CnetEvent;
+
+//  DESCRIBES THE NODE WHOSE EVENT IS BEING HANDLED, REFRESHED BEFORE EVERY EVENT
+typedef struct {
+    CnetNodeType    nodetype;
+    int             nodenumber;             // 0 .. number of nodes - 1
+    CnetAddr        address;
+    char            nodename[32];
+    int             nlinks;                 // links are numbered 1 .. nlinks, link 0 is the loopback
+    CnetTime        time_in_usec;
+} CnetNodeInfo;
+
+//  DESCRIBES EACH LINK OF THAT NODE, INDEXED 0 .. nlinks
+typedef struct {
+    bool            linkup;
+    int             bandwidth;              // bits per second
+    CnetTime        propagationdelay;       // usec
+} CnetLinkInfo;
+
+extern CnetNodeInfo nodeinfo;
+extern CnetLinkInfo *linkinfo;
+
+#define EVENT_HANDLER(name) void name(CnetEvent ev, CnetTimerID timer, CnetData data)
+
+//  EVERY API FUNCTION RETURNS 0 ON SUCCESS, OR -1 WITH cnet_errno SET TO ONE OF THESE
+typedef enum {
+    ER_OK, ER_BADARG, ER_BADEVENT, ER_BADLINK, ER_BADNODE, ER_BADSIZE,
+    ER_BADTIMERID, ER_NOTREADY, ER_NOTSUPPORTED, ER_TOOBUSY
+} CnetError;
+
+extern int          cnet_errno;
+extern const char   *cnet_errname[];
+
+extern int          CNET_set_handler(CnetEvent ev, void (*handler)(CnetEvent, CnetTimerID, CnetData), CnetData data);
+extern int          CNET_read_physical(int *link, void *frame, size_t *length);
+extern int          CNET_write_physical(int link, void *frame, size_t *length);
+extern int          CNET_read_application(CnetAddr *destaddr, void *msg, size_t *length);
+extern int          CNET_write_application(void *msg, size_t *length);
+extern int          CNET_enable_application(CnetAddr destaddr);
+extern int          CNET_disable_application(CnetAddr destaddr);
+extern CnetTimerID  CNET_start_timer(CnetEvent ev, CnetTime usecs, CnetData data);
+extern int          CNET_stop_timer(CnetTimerID timer);
+extern int          CNET_set_debug_string(CnetEvent ev, const char *str);
+extern uint16_t     CNET_ccitt(unsigned char *addr, size_t nbytes);
+extern uint32_t     CNET_crc32(unsigned char *addr, size_t nbytes);
+extern char         *CNET_getvar(const char *name);
+extern void         CNET_exit(const char *filename, const char *function, int lineno);
+
+#define CHECK(call) do { if((call) != 0) CNET_exit(__FILE__, __func__, __LINE__); } while(0)
+
+#endif
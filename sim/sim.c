@@ -0,0 +1,1531 @@
+//  A HEADLESS STAND-IN FOR THE CNET RUNTIME: A DISCRETE-EVENT SIMULATOR THAT READS A CNET TOPOLOGY FILE,
+//  LOADS THE PROTOCOL (BUILT AS A SHARED OBJECT) ONCE PER NODE AND DRIVES IT THROUGH THE CNET API.
+//
+//  EVERY NODE GETS A PRIVATE dlopen()ED COPY OF THE PROTOCOL, SO ITS GLOBALS ARE ITS OWN, AS THEY ARE UNDER
+//  CNET. THE PROTOCOL'S REFERENCES TO nodeinfo, linkinfo AND THE CNET_* FUNCTIONS RESOLVE TO THIS
+//  EXECUTABLE, WHICH IS LINKED WITH -rdynamic. EVERYTHING ELSE HERE IS static SO THAT IT CANNOT CAPTURE
+//  A NAME THE PROTOCOL DEFINES FOR ITSELF.
+//
+//  THE APPLICATION LAYER STAMPS EVERY MESSAGE WITH ITS SOURCE, DESTINATION, SEQUENCE NUMBER AND CREATION
+//  TIME, SO THAT DELIVERY CAN BE CHECKED (IN ORDER, EXACTLY ONCE, UNCORRUPTED) AND ITS LATENCY MEASURED.
+//  A RUN IS A PURE FUNCTION OF THE TOPOLOGY, THE PROTOCOL AND THE SEED.
+
+#define _GNU_SOURCE
+#include "cnet.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <stdarg.h>
+
+//  THE LARGEST FRAME A LINK CARRIES
+#define MAX_FRAME_SIZE      (MAX_MESSAGE_SIZE + 1024)
+
+//  THE API'S GLOBALS, REFRESHED BEFORE EVERY EVENT FROM THE NODE IT IS FOR
+CnetNodeInfo    nodeinfo;
+CnetLinkInfo    *linkinfo;
+int             cnet_errno = ER_OK;
+
+const char *cnet_errname[] = {
+    "ER_OK", "ER_BADARG", "ER_BADEVENT", "ER_BADLINK", "ER_BADNODE", "ER_BADSIZE",
+    "ER_BADTIMERID", "ER_NOTREADY", "ER_NOTSUPPORTED", "ER_TOOBUSY"
+};
+
+typedef void (*HANDLER)(CnetEvent, CnetTimerID, CnetData);
+
+//  ATTRIBUTES A TOPOLOGY FILE MAY GIVE GLOBALLY, PER NODE OR PER LINK
+typedef enum {
+    A_BANDWIDTH, A_PROPAGATIONDELAY, A_PROBFRAMELOSS, A_PROBFRAMECORRUPT,
+    A_MESSAGERATE, A_MINMESSAGESIZE, A_MAXMESSAGESIZE, N_ATTRS
+} ATTR;
+
+static const char *attrname[N_ATTRS] = {
+    "bandwidth", "propagationdelay", "probframeloss", "probframecorrupt",
+    "messagerate", "minmessagesize", "maxmessagesize"
+};
+
+//  CNET'S OWN DEFAULTS, EXCEPT THAT FRAMES ARE NEITHER LOST NOR CORRUPTED UNLESS ASKED FOR
+static const double attrdefault[N_ATTRS] = {
+    56000, 2500000, 0, 0, 1000000, 100, 1000
+};
+
+#define UNSET               (-1.0)
+
+//  A var name = "value" FROM THE TOPOLOGY FILE OR THE COMMAND LINE
+typedef struct {
+    char        *name;
+    char        *value;
+} VAR;
+
+//  A BIDIRECTIONAL LINK, EACH DIRECTION TRANSMITS ONE FRAME AT A TIME
+typedef struct {
+    int         node[2];                // the two ends, frames written at node[d] travel in direction d
+    int         nodelink[2];            // the link's number at each end
+    bool        matched;                // the far end has declared it too
+    double      attr[N_ATTRS];          // as declared on the link itself, UNSET if not
+    int         bandwidth;
+    CnetTime    propagationdelay;
+    int         probframeloss;          // lose one frame in 2^probframeloss
+    int         probframecorrupt;
+    CnetTime    busyuntil[2];
+    long        frames[2];
+    long        bytes[2];
+    CnetTime    busy[2];                // total time spent transmitting
+    long        lost;
+    long        corrupted;
+} LINK;
+
+//  THE HEADER THE SIMULATED APPLICATION PUTS AT THE FRONT OF EVERY MESSAGE
+typedef struct {
+    int32_t     source;
+    int32_t     destination;
+    uint32_t    seq;
+    uint32_t    length;
+    int64_t     created;
+} MSGHEADER;
+
+typedef struct {
+    CnetNodeInfo    info;
+    bool            defined;
+    double          attr[N_ATTRS];      // as declared on the node, UNSET if not
+    bool            hasaddress;
+    int             hostindex;          // position among the hosts, -1 for a router
+    CnetLinkInfo    *linkinfo;          // 0 .. nlinks
+    int             *links;             // 2*link index + direction of each link, 0 .. nlinks
+    int             maxlinks;
+
+    void            *dl;
+    HANDLER         handler[N_CNET_EVENTS];
+    CnetData        handlerdata[N_CNET_EVENTS];
+
+//  THE APPLICATION LAYER
+    CnetTime        messagerate;
+    int             minmessagesize;
+    int             maxmessagesize;
+    bool            *enabled;           // per destination host
+    bool            appwaiting;         // no destination was enabled when the next message was due
+    bool            appready;           // a message is on offer to CNET_read_application
+    CnetAddr        appdest;
+    size_t          applength;
+    uint32_t        *nextseq;           // per destination host
+    CnetTime        **created;          // per destination host, the creation time of every message by seq
+    uint32_t        *maxcreated;        // per destination host
+    uint32_t        *expected;          // per source host
+    CnetTime        *lastdelivered;     // per source host, -1 before the first
+
+//  THE FRAME ON OFFER TO CNET_read_physical
+    bool            rxready;
+    unsigned char   *rxframe;
+    size_t          rxlength;
+    int             rxlink;
+} NODE;
+
+//  THE EVENT QUEUE IS A BINARY HEAP ORDERED ON TIME, TIES BROKEN IN ORDER OF SCHEDULING
+typedef enum { SE_TIMER, SE_FRAME, SE_APPLICATION } SIMEVENT;
+
+typedef struct {
+    CnetTime        time;
+    uint64_t        order;
+    SIMEVENT        kind;
+    int             node;
+    CnetEvent       ev;
+    int             link;
+    CnetTimerID     timer;
+    CnetData        data;
+    unsigned char   *frame;
+    size_t          length;
+} EVENT;
+
+static NODE     *nodes      = NULL;
+static int      numnodes    = 0;
+static int      maxnodes    = 0;
+static LINK     *links      = NULL;
+static int      numlinks    = 0;
+static int      maxlinks    = 0;
+static int      *hosts      = NULL;     // node number of each host
+static int      numhosts    = 0;
+static VAR      *vars       = NULL;
+static int      numvars     = 0;
+static double   attr[N_ATTRS];          // global attributes from the topology file
+static double   forced[N_ATTRS];        // from -o on the command line, overriding everything
+
+static EVENT    *heap       = NULL;
+static int      heapsize    = 0;
+static int      maxheap     = 0;
+static uint64_t nextorder   = 0;
+
+static CnetTime now         = 0;
+static NODE     *current    = NULL;
+static bool     queuewrites = false;   // a write to a busy link fails with ER_TOOBUSY, as under cnet
+static bool     quiet       = false;
+static bool     json        = false;
+
+//  TIMER IDS ARE A SLOT NUMBER AND THE GENERATION OF THAT SLOT, SO A STOPPED TIMER'S EVENT IS RECOGNISED
+static uint32_t *timergen   = NULL;
+static int      *timerowner = NULL;
+static int      *timerfree  = NULL;
+static int      numtimers   = 0;
+static int      maxtimers   = 0;
+static int      numfree     = 0;
+
+//  WHAT HAPPENED
+static long     events      = 0;
+static long     generated   = 0;
+static long     delivered   = 0;
+static long     duplicated  = 0;
+static long     missing     = 0;
+static long     undelivered = 0;        // still on the way at the end, though created at least grace earlier
+static long     misdelivered = 0;
+static long     damaged     = 0;
+static long     deliveredbytes = 0;
+static CnetTime *latency    = NULL;
+static long     maxlatency  = 0;
+
+//  FRAMES AT LEAST AS LONG AS THE SHORTEST MESSAGE ARE TAKEN TO CARRY DATA, ANYTHING SHORTER IS CONTROL
+static size_t   datasize    = 0;
+static long     dataframes  = 0;
+static long     minframes   = 0;        // data frames an ideal protocol would have sent, one per hop
+static int      *hopcount   = NULL;     // shortest path between each pair of hosts, in links
+
+//  ------------------------------------------------------------------------------------------------------
+//  A SPLITMIX64 GENERATOR, ONE STREAM FOR THE WHOLE SIMULATION SO THAT A SEED FIXES THE RUN
+
+static uint64_t rngstate    = 1;
+
+static uint64_t rng_next(void)
+{
+    uint64_t z = (rngstate += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static double rng_uniform(void)
+{
+    return (rng_next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+//  TRUE WITH PROBABILITY 1 IN 2^n, CNET'S WAY OF GIVING LOSS AND CORRUPTION RATES
+static bool rng_oneinpow2(int n)
+{
+    return n > 0 && (rng_next() & ((1ULL << n) - 1)) == 0;
+}
+
+//  ------------------------------------------------------------------------------------------------------
+//  THE EVENT QUEUE
+
+static bool heap_before(EVENT *a, EVENT *b)
+{
+    return a->time < b->time || (a->time == b->time && a->order < b->order);
+}
+
+static void schedule(EVENT *e)
+{
+    if(heapsize == maxheap)
+    {
+        maxheap = maxheap ? 2*maxheap : 1024;
+        heap    = realloc(heap, maxheap * sizeof(EVENT));
+    }
+    e->order = nextorder++;
+
+    int i = heapsize++;
+    while(i > 0 && heap_before(e, &heap[(i - 1) / 2]))
+    {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = *e;
+}
+
+static EVENT unschedule(void)
+{
+    EVENT   top = heap[0];
+    EVENT   last = heap[--heapsize];
+    int     i = 0;
+
+    for(;;)
+    {
+        int child = 2*i + 1;
+
+        if(child >= heapsize)
+            break;
+        if(child + 1 < heapsize && heap_before(&heap[child + 1], &heap[child]))
+            child++;
+        if(!heap_before(&heap[child], &last))
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+    return top;
+}
+
+//  ------------------------------------------------------------------------------------------------------
+//  THE TOPOLOGY FILE
+
+static char     *src;
+static int      lineno;
+static const char *srcname;
+static char     tok[256];
+
+typedef enum { T_EOF, T_WORD, T_NUMBER, T_STRING, T_PUNCT } TOKTYPE;
+static TOKTYPE  toktype;
+
+static void parse_error(const char *what)
+{
+    fprintf(stderr, "%s:%i: %s near '%s'\n", srcname, lineno, what, tok);
+    exit(2);
+}
+
+static void next_token(void)
+{
+    for(;;)
+    {
+        while(isspace((unsigned char)*src))
+        {
+            if(*src++ == '\n')
+                lineno++;
+        }
+        if(*src == '#' || (src[0] == '/' && src[1] == '/'))
+        {
+            while(*src && *src != '\n')
+                src++;
+        }
+        else if(src[0] == '/' && src[1] == '*')
+        {
+            for(src += 2; *src && !(src[0] == '*' && src[1] == '/'); src++)
+                if(*src == '\n')
+                    lineno++;
+            if(*src)
+                src += 2;
+        }
+        else
+            break;
+    }
+
+    size_t n = 0;
+    if(*src == '\0')
+    {
+        toktype = T_EOF;
+        tok[0]  = '\0';
+        return;
+    }
+    if(*src == '"')
+    {
+        for(src++; *src && *src != '"' && n < sizeof(tok) - 1; )
+            tok[n++] = *src++;
+        if(*src != '"')
+            parse_error("unterminated string");
+        src++;
+        toktype = T_STRING;
+    }
+    else if(isdigit((unsigned char)*src) || *src == '.' || *src == '-')
+    {
+        while((isdigit((unsigned char)*src) || *src == '.' || *src == '-' || *src == 'e') && n < sizeof(tok) - 1)
+            tok[n++] = *src++;
+        toktype = T_NUMBER;
+    }
+    else if(isalpha((unsigned char)*src) || *src == '_')
+    {
+        while((isalnum((unsigned char)*src) || *src == '_' || *src == '.') && n < sizeof(tok) - 1)
+            tok[n++] = *src++;
+        toktype = T_WORD;
+    }
+    else
+    {
+        tok[n++] = *src++;
+        toktype = T_PUNCT;
+    }
+    tok[n] = '\0';
+}
+
+static bool is_punct(char c)
+{
+    return toktype == T_PUNCT && tok[0] == c;
+}
+
+static void expect(char c)
+{
+    if(!is_punct(c))
+    {
+        char what[32];
+        sprintf(what, "expected '%c'", c);
+        parse_error(what);
+    }
+    next_token();
+}
+
+//  A NUMBER WITH AN OPTIONAL UNIT, SCALED TO BITS PER SECOND, USEC OR BYTES
+static double parse_number(void)
+{
+    static const struct { const char *unit; double scale; } units[] = {
+        { "bps", 1 },       { "Kbps", 1e3 },    { "Mbps", 1e6 },    { "Gbps", 1e9 },
+        { "usec", 1 },      { "us", 1 },        { "ms", 1e3 },      { "msec", 1e3 },
+        { "s", 1e6 },       { "sec", 1e6 },     { "bytes", 1 },     { "byte", 1 },
+        { "KB", 1024 },     { "Kbytes", 1024 }, { "MB", 1048576 },
+    };
+
+    if(toktype != T_NUMBER)
+        parse_error("expected a number");
+    double value = atof(tok);
+    next_token();
+    if(toktype == T_WORD)
+    {
+        for(size_t i = 0; i < sizeof(units) / sizeof(units[0]); i++)
+        {
+            if(strcmp(tok, units[i].unit) == 0)
+            {
+                value *= units[i].scale;
+                next_token();
+                break;
+            }
+        }
+    }
+    return value;
+}
+
+static int find_attr(const char *name)
+{
+    for(int a = 0; a < N_ATTRS; a++)
+        if(strcmp(name, attrname[a]) == 0)
+            return a;
+    return -1;
+}
+
+//  name = value, STORED IN attrs IF IT IS AN ATTRIBUTE WE MODEL AND IGNORED OTHERWISE
+static void parse_assignment(const char *name, double *attrs)
+{
+    int a = find_attr(name);
+
+    expect('=');
+    if(a != -1)
+        attrs[a] = parse_number();
+    else if(toktype == T_NUMBER)
+        parse_number();
+    else if(toktype == T_STRING || toktype == T_WORD)
+        next_token();
+    else
+        parse_error("expected a value");
+}
+
+static void set_var(const char *name, const char *value)
+{
+    for(int i = 0; i < numvars; i++)
+    {
+        if(strcmp(vars[i].name, name) == 0)
+        {
+            free(vars[i].value);
+            vars[i].value = strdup(value);
+            return;
+        }
+    }
+    vars = realloc(vars, (numvars + 1) * sizeof(VAR));
+    vars[numvars].name  = strdup(name);
+    vars[numvars].value = strdup(value);
+    numvars++;
+}
+
+static int find_node(const char *name)
+{
+    for(int n = 0; n < numnodes; n++)
+        if(strcmp(nodes[n].info.nodename, name) == 0)
+            return n;
+
+    if(numnodes == maxnodes)
+    {
+        maxnodes = maxnodes ? 2*maxnodes : 16;
+        nodes    = realloc(nodes, maxnodes * sizeof(NODE));
+    }
+    NODE *n = &nodes[numnodes];
+    memset(n, 0, sizeof(NODE));
+    snprintf(n->info.nodename, sizeof(n->info.nodename), "%.31s", name);
+    n->info.nodenumber = numnodes;
+    for(int a = 0; a < N_ATTRS; a++)
+        n->attr[a] = UNSET;
+    n->maxlinks = 4;
+    n->links    = malloc(n->maxlinks * sizeof(int));
+    n->links[0] = -1;               // the loopback
+    return numnodes++;
+}
+
+static void add_nodelink(int node, int value)
+{
+    NODE *n = &nodes[node];
+
+    if(n->info.nlinks + 1 == n->maxlinks)
+    {
+        n->maxlinks *= 2;
+        n->links     = realloc(n->links, n->maxlinks * sizeof(int));
+    }
+    n->links[++n->info.nlinks] = value;
+}
+
+//  link to far, JOINING A LINK far HAS ALREADY DECLARED BACK TO THIS NODE IF THERE IS ONE
+static LINK *declare_link(int node, int far)
+{
+    for(int l = 0; l < numlinks; l++)
+    {
+        if(links[l].node[0] == far && links[l].node[1] == node && !links[l].matched)
+        {
+            links[l].matched = true;
+            return &links[l];
+        }
+    }
+    if(numlinks == maxlinks)
+    {
+        maxlinks = maxlinks ? 2*maxlinks : 16;
+        links    = realloc(links, maxlinks * sizeof(LINK));
+    }
+    LINK *l = &links[numlinks];
+    memset(l, 0, sizeof(LINK));
+    l->node[0] = node;
+    l->node[1] = far;
+    for(int a = 0; a < N_ATTRS; a++)
+        l->attr[a] = UNSET;
+    add_nodelink(node, 2*numlinks);
+    l->nodelink[0] = nodes[node].info.nlinks;
+    add_nodelink(far, 2*numlinks + 1);
+    l->nodelink[1] = nodes[far].info.nlinks;
+    numlinks++;
+    return l;
+}
+
+static void parse_node(CnetNodeType type)
+{
+    if(toktype != T_WORD)
+        parse_error("expected a node name");
+
+    int node = find_node(tok);
+    if(nodes[node].defined)
+        parse_error("node defined twice");
+    nodes[node].defined       = true;
+    nodes[node].info.nodetype = type;
+    next_token();
+    expect('{');
+    while(!is_punct('}'))
+    {
+        if(toktype != T_WORD)
+            parse_error("expected an attribute or link");
+
+        char name[sizeof(tok)];
+        strcpy(name, tok);
+        next_token();
+        if(strcmp(name, "link") == 0)
+        {
+            if(toktype != T_WORD || strcmp(tok, "to") != 0)
+                parse_error("expected 'to'");
+            next_token();
+            if(toktype != T_WORD)
+                parse_error("expected a node name");
+
+            int far = find_node(tok);
+            if(far == node)
+                parse_error("a node cannot link to itself");
+            LINK *l = declare_link(node, far);
+            next_token();
+            if(is_punct('{'))
+            {
+                next_token();
+                while(!is_punct('}'))
+                {
+                    char linkattr[sizeof(tok)];
+                    strcpy(linkattr, tok);
+                    next_token();
+                    parse_assignment(linkattr, l->attr);
+                    if(is_punct(','))
+                        next_token();
+                }
+                next_token();
+            }
+        }
+        else if(strcmp(name, "address") == 0)
+        {
+            expect('=');
+            nodes[node].info.address = (CnetAddr)parse_number();
+            nodes[node].hasaddress   = true;
+        }
+        else
+            parse_assignment(name, nodes[node].attr);
+
+        if(is_punct(','))
+            next_token();
+    }
+    next_token();
+}
+
+static void parse_topology(const char *filename)
+{
+    FILE    *fp = fopen(filename, "r");
+    char    *text;
+    long    length;
+
+    if(fp == NULL)
+    {
+        perror(filename);
+        exit(2);
+    }
+    fseek(fp, 0, SEEK_END);
+    length = ftell(fp);
+    rewind(fp);
+    text = malloc(length + 1);
+    length = fread(text, 1, length, fp);
+    text[length] = '\0';
+    fclose(fp);
+
+    src     = text;
+    srcname = filename;
+    lineno  = 1;
+    next_token();
+    while(toktype != T_EOF)
+    {
+        if(is_punct(',') || is_punct(';'))
+        {
+            next_token();
+            continue;
+        }
+        if(toktype != T_WORD)
+            parse_error("expected a definition");
+
+        char name[sizeof(tok)];
+        strcpy(name, tok);
+        next_token();
+        if(strcmp(name, "host") == 0)
+            parse_node(NT_HOST);
+        else if(strcmp(name, "router") == 0)
+            parse_node(NT_ROUTER);
+        else if(strcmp(name, "var") == 0)
+        {
+            if(toktype != T_WORD)
+                parse_error("expected a variable name");
+            strcpy(name, tok);
+            next_token();
+            expect('=');
+            if(toktype != T_STRING && toktype != T_NUMBER && toktype != T_WORD)
+                parse_error("expected a value");
+            set_var(name, tok);
+            next_token();
+        }
+        else
+            parse_assignment(name, attr);
+    }
+    free(text);
+}
+
+//  -o name=value ON THE COMMAND LINE, AN ATTRIBUTE (WITH ITS UNIT) OR ELSE A var
+static void parse_override(char *arg)
+{
+    char *value = strchr(arg, '=');
+
+    if(value == NULL)
+    {
+        fprintf(stderr, "-o expects name=value, not '%s'\n", arg);
+        exit(2);
+    }
+    *value++ = '\0';
+
+    int a = find_attr(arg);
+    if(a == -1)
+    {
+        set_var(arg, value);
+        return;
+    }
+    src     = value;
+    srcname = "-o";
+    lineno  = 0;
+    next_token();
+    forced[a] = parse_number();
+}
+
+//  THE VALUE OF AN ATTRIBUTE AFTER THE COMMAND LINE, A LINK'S OWN, ITS DECLARING NODE'S AND THE GLOBAL ONE
+static double resolve(ATTR a, double linkattr, double nodeattr)
+{
+    if(forced[a] != UNSET)
+        return forced[a];
+    if(linkattr != UNSET)
+        return linkattr;
+    if(nodeattr != UNSET)
+        return nodeattr;
+    if(attr[a] != UNSET)
+        return attr[a];
+    return attrdefault[a];
+}
+
+static void build_network(void)
+{
+    for(int n = 0; n < numnodes; n++)
+    {
+        if(!nodes[n].defined)
+        {
+            fprintf(stderr, "%s: node '%s' is linked to but never defined\n", srcname, nodes[n].info.nodename);
+            exit(2);
+        }
+    }
+
+//  NODES WITHOUT AN ADDRESS OF THEIR OWN GET THE LOWEST FREE ONE FROM 1 UP
+    CnetAddr candidate = 1;
+    for(int n = 0; n < numnodes; n++)
+    {
+        if(nodes[n].hasaddress)
+            continue;
+        for(bool taken = true; taken; candidate++)
+        {
+            taken = false;
+            for(int m = 0; m < numnodes; m++)
+                if((nodes[m].hasaddress || m < n) && nodes[m].info.address == candidate)
+                    taken = true;
+            if(!taken)
+                nodes[n].info.address = candidate;
+        }
+    }
+
+    for(int l = 0; l < numlinks; l++)
+    {
+        LINK    *link = &links[l];
+        double  *nodeattr = nodes[link->node[0]].attr;
+
+        link->bandwidth         = resolve(A_BANDWIDTH, link->attr[A_BANDWIDTH], nodeattr[A_BANDWIDTH]);
+        link->propagationdelay  = resolve(A_PROPAGATIONDELAY, link->attr[A_PROPAGATIONDELAY], nodeattr[A_PROPAGATIONDELAY]);
+        link->probframeloss     = resolve(A_PROBFRAMELOSS, link->attr[A_PROBFRAMELOSS], nodeattr[A_PROBFRAMELOSS]);
+        link->probframecorrupt  = resolve(A_PROBFRAMECORRUPT, link->attr[A_PROBFRAMECORRUPT], nodeattr[A_PROBFRAMECORRUPT]);
+        if(link->bandwidth <= 0)
+            link->bandwidth = attrdefault[A_BANDWIDTH];
+    }
+
+    hosts = malloc(numnodes * sizeof(int));
+    for(int n = 0; n < numnodes; n++)
+    {
+        nodes[n].hostindex = -1;
+        if(nodes[n].info.nodetype == NT_HOST)
+        {
+            nodes[n].hostindex = numhosts;
+            hosts[numhosts++]  = n;
+        }
+    }
+
+    for(int n = 0; n < numnodes; n++)
+    {
+        NODE *node = &nodes[n];
+
+        node->linkinfo = calloc(node->info.nlinks + 1, sizeof(CnetLinkInfo));
+        node->linkinfo[0].linkup            = true;
+        node->linkinfo[0].bandwidth         = 0;
+        node->linkinfo[0].propagationdelay  = 0;
+        for(int i = 1; i <= node->info.nlinks; i++)
+        {
+            LINK *link = &links[node->links[i] / 2];
+            node->linkinfo[i].linkup            = true;
+            node->linkinfo[i].bandwidth         = link->bandwidth;
+            node->linkinfo[i].propagationdelay  = link->propagationdelay;
+        }
+
+        node->messagerate       = resolve(A_MESSAGERATE, UNSET, node->attr[A_MESSAGERATE]);
+        node->minmessagesize    = resolve(A_MINMESSAGESIZE, UNSET, node->attr[A_MINMESSAGESIZE]);
+        node->maxmessagesize    = resolve(A_MAXMESSAGESIZE, UNSET, node->attr[A_MAXMESSAGESIZE]);
+        if(node->minmessagesize < (int)sizeof(MSGHEADER))
+            node->minmessagesize = sizeof(MSGHEADER);
+        if(node->maxmessagesize > MAX_MESSAGE_SIZE)
+            node->maxmessagesize = MAX_MESSAGE_SIZE;
+        if(node->maxmessagesize < node->minmessagesize)
+            node->maxmessagesize = node->minmessagesize;
+        if(node->messagerate < 1)
+            node->messagerate = 1;
+        node->enabled   = calloc(numhosts, sizeof(bool));
+        node->nextseq   = calloc(numhosts, sizeof(uint32_t));
+        node->expected  = calloc(numhosts, sizeof(uint32_t));
+        node->lastdelivered = malloc(numhosts * sizeof(CnetTime));
+        for(int h = 0; h < numhosts; h++)
+            node->lastdelivered[h] = -1;
+        node->created   = calloc(numhosts, sizeof(CnetTime *));
+        node->maxcreated = calloc(numhosts, sizeof(uint32_t));
+        if(node->hostindex != -1 && (datasize == 0 || (size_t)node->minmessagesize < datasize))
+            datasize = node->minmessagesize;
+    }
+
+//  A BREADTH-FIRST SEARCH FROM EVERY HOST GIVES THE FEWEST LINKS EACH MESSAGE COULD HAVE CROSSED
+    int *distance = malloc(numnodes * sizeof(int));
+    int *fifo = malloc(numnodes * sizeof(int));
+    hopcount = malloc(numhosts * numhosts * sizeof(int));
+    for(int h = 0; h < numhosts; h++)
+    {
+        int head = 0, tail = 0;
+
+        for(int n = 0; n < numnodes; n++)
+            distance[n] = -1;
+        distance[hosts[h]] = 0;
+        fifo[tail++] = hosts[h];
+        while(head < tail)
+        {
+            NODE *node = &nodes[fifo[head++]];
+            for(int i = 1; i <= node->info.nlinks; i++)
+            {
+                LINK    *link = &links[node->links[i] / 2];
+                int     far = link->node[1 - node->links[i] % 2];
+
+                if(distance[far] == -1)
+                {
+                    distance[far] = distance[node->info.nodenumber] + 1;
+                    fifo[tail++]  = far;
+                }
+            }
+        }
+        for(int g = 0; g < numhosts; g++)
+            hopcount[h*numhosts + g] = distance[hosts[g]];
+    }
+    free(distance);
+    free(fifo);
+}
+
+static int host_of(CnetAddr address)
+{
+    for(int h = 0; h < numhosts; h++)
+        if(nodes[hosts[h]].info.address == address)
+            return h;
+    return -1;
+}
+
+//  ------------------------------------------------------------------------------------------------------
+//  LOADING THE PROTOCOL, ONE PRIVATE COPY PER NODE
+
+static void load_protocol(const char *path)
+{
+    FILE    *fp = fopen(path, "rb");
+    char    dir[] = "/tmp/cnetsim.XXXXXX";
+    char    copy[sizeof(dir) + 32];
+    char    *image;
+    long    length;
+
+    if(fp == NULL)
+    {
+        perror(path);
+        exit(2);
+    }
+    fseek(fp, 0, SEEK_END);
+    length = ftell(fp);
+    rewind(fp);
+    image = malloc(length);
+    if(fread(image, 1, length, fp) != (size_t)length)
+    {
+        perror(path);
+        exit(2);
+    }
+    fclose(fp);
+
+    if(mkdtemp(dir) == NULL)
+    {
+        perror(dir);
+        exit(2);
+    }
+    for(int n = 0; n < numnodes; n++)
+    {
+        sprintf(copy, "%s/node%i.so", dir, n);
+        fp = fopen(copy, "wb");
+        if(fp == NULL || fwrite(image, 1, length, fp) != (size_t)length || fclose(fp) != 0)
+        {
+            perror(copy);
+            exit(2);
+        }
+        nodes[n].dl = dlopen(copy, RTLD_NOW | RTLD_LOCAL);
+        unlink(copy);
+        if(nodes[n].dl == NULL)
+        {
+            fprintf(stderr, "%s\n", dlerror());
+            exit(2);
+        }
+        nodes[n].handler[EV_REBOOT] = (HANDLER)dlsym(nodes[n].dl, "reboot_node");
+        if(nodes[n].handler[EV_REBOOT] == NULL)
+        {
+            fprintf(stderr, "%s: no reboot_node() to start the protocol with\n", path);
+            exit(2);
+        }
+    }
+    rmdir(dir);
+    free(image);
+}
+
+//  ------------------------------------------------------------------------------------------------------
+//  RUNNING THE PROTOCOL
+
+static void dispatch(NODE *node, CnetEvent ev, CnetTimerID timer, CnetData data)
+{
+    current                 = node;
+    nodeinfo                = node->info;
+    nodeinfo.time_in_usec   = now;
+    linkinfo                = node->linkinfo;
+    events++;
+    node->handler[ev](ev, timer, data);
+}
+
+static void schedule_application(int node, CnetTime when)
+{
+    EVENT e = { .time = when, .kind = SE_APPLICATION, .node = node };
+
+    schedule(&e);
+}
+
+//  THE NEXT MESSAGE IS DUE AFTER AN EXPONENTIALLY DISTRIBUTED INTERVAL AVERAGING messagerate
+static CnetTime message_interval(NODE *node)
+{
+    CnetTime interval = -(double)node->messagerate * log(1.0 - rng_uniform());
+
+    return interval < 1 ? 1 : interval;
+}
+
+//  THE BODY OF A MESSAGE FOLLOWS FROM ITS HEADER, SO THE RECEIVING END CAN TELL IF IT WAS DAMAGED
+static void fill_body(unsigned char *body, size_t length, MSGHEADER *header)
+{
+    uint64_t x = ((uint64_t)(uint32_t)header->source << 32 | (uint32_t)header->destination) ^ ((uint64_t)header->seq * 0x9e3779b97f4a7c15ULL);
+
+    for(size_t i = 0; i < length; i++)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        body[i] = x;
+    }
+}
+
+static void application_event(int n)
+{
+    NODE    *node = &nodes[n];
+    int     enabled = 0;
+
+    for(int h = 0; h < numhosts; h++)
+        if(node->enabled[h])
+            enabled++;
+    if(enabled == 0)
+    {
+        node->appwaiting = true;
+        return;
+    }
+
+    int pick = rng_next() % enabled;
+    for(int h = 0; h < numhosts; h++)
+    {
+        if(node->enabled[h] && pick-- == 0)
+        {
+            node->appdest = nodes[hosts[h]].info.address;
+            break;
+        }
+    }
+    node->applength = node->minmessagesize + rng_next() % (node->maxmessagesize - node->minmessagesize + 1);
+    node->appready  = true;
+    if(node->handler[EV_APPLICATIONREADY] != NULL)
+        dispatch(node, EV_APPLICATIONREADY, NULLTIMER, node->handlerdata[EV_APPLICATIONREADY]);
+    node->appready  = false;
+    schedule_application(n, now + message_interval(node));
+}
+
+static void frame_event(EVENT *e)
+{
+    NODE *node = &nodes[e->node];
+
+    node->rxready   = true;
+    node->rxframe   = e->frame;
+    node->rxlength  = e->length;
+    node->rxlink    = e->link;
+    if(node->handler[EV_PHYSICALREADY] != NULL)
+        dispatch(node, EV_PHYSICALREADY, NULLTIMER, node->handlerdata[EV_PHYSICALREADY]);
+    node->rxready   = false;
+    free(e->frame);
+}
+
+static void timer_event(EVENT *e)
+{
+    int slot = (e->timer & 0xffffffff) - 1;
+
+    if(timergen[slot] != (uint32_t)(e->timer >> 32))
+        return;             // stopped
+    timergen[slot]++;
+    timerfree[numfree++] = slot;
+
+    NODE *node = &nodes[e->node];
+    if(node->handler[e->ev] != NULL)
+        dispatch(node, e->ev, e->timer, e->data);
+}
+
+//  ------------------------------------------------------------------------------------------------------
+//  THE CNET API
+
+int CNET_set_handler(CnetEvent ev, HANDLER handler, CnetData data)
+{
+    if(ev <= EV_NULL || ev >= N_CNET_EVENTS)
+    {
+        cnet_errno = ER_BADEVENT;
+        return -1;
+    }
+    current->handler[ev]        = handler;
+    current->handlerdata[ev]    = data;
+    return 0;
+}
+
+//  THERE ARE NO DEBUG BUTTONS TO LABEL, SO ONLY THE EVENT IS CHECKED
+int CNET_set_debug_string(CnetEvent ev, const char *str)
+{
+    if(ev != EV_DEBUG0 && ev != EV_DEBUG1)
+    {
+        cnet_errno = ER_BADEVENT;
+        return -1;
+    }
+    return 0;
+}
+
+int CNET_read_physical(int *link, void *frame, size_t *length)
+{
+    if(!current->rxready)
+    {
+        cnet_errno = ER_NOTREADY;
+        return -1;
+    }
+    if(*length < current->rxlength)
+    {
+        cnet_errno = ER_BADSIZE;
+        return -1;
+    }
+    memcpy(frame, current->rxframe, current->rxlength);
+    *length         = current->rxlength;
+    *link           = current->rxlink;
+    current->rxready = false;
+    return 0;
+}
+
+int CNET_write_physical(int link, void *frame, size_t *length)
+{
+    EVENT e = { .kind = SE_FRAME };
+
+    if(link < 0 || link > current->info.nlinks)
+    {
+        cnet_errno = ER_BADLINK;
+        return -1;
+    }
+    if(*length == 0 || *length > MAX_FRAME_SIZE)
+    {
+        cnet_errno = ER_BADSIZE;
+        return -1;
+    }
+    if(link == 0)
+    {
+        e.time      = now;
+        e.node      = current->info.nodenumber;
+        e.link      = 0;
+        e.frame     = malloc(*length);
+        e.length    = *length;
+        memcpy(e.frame, frame, *length);
+        schedule(&e);
+        return 0;
+    }
+
+    LINK        *l = &links[current->links[link] / 2];
+    int         dir = current->links[link] % 2;
+    CnetTime    start = now;
+
+//  A LINK TRANSMITS ONE FRAME AT A TIME, A WRITE WHILE IT IS BUSY WAITS ITS TURN OR IS REFUSED
+    if(l->busyuntil[dir] > now)
+    {
+        if(!queuewrites)
+        {
+            cnet_errno = ER_TOOBUSY;
+            return -1;
+        }
+        start = l->busyuntil[dir];
+    }
+
+    CnetTime transmit = (CnetTime)*length * 8 * 1000000 / l->bandwidth;
+    l->busyuntil[dir]   = start + transmit;
+    l->busy[dir]        += transmit;
+    l->frames[dir]++;
+    l->bytes[dir]       += *length;
+    if(*length >= datasize)
+        dataframes++;
+
+    if(rng_oneinpow2(l->probframeloss))
+    {
+        l->lost++;
+        return 0;
+    }
+    e.time      = start + transmit + l->propagationdelay;
+    e.node      = l->node[1 - dir];
+    e.link      = l->nodelink[1 - dir];
+    e.frame     = malloc(*length);
+    e.length    = *length;
+    memcpy(e.frame, frame, *length);
+    if(rng_oneinpow2(l->probframecorrupt))
+    {
+        e.frame[rng_next() % *length] ^= 1 + rng_next() % 255;
+        l->corrupted++;
+    }
+    schedule(&e);
+    return 0;
+}
+
+int CNET_read_application(CnetAddr *destaddr, void *msg, size_t *length)
+{
+    if(!current->appready)
+    {
+        cnet_errno = ER_NOTREADY;
+        return -1;
+    }
+    if(*length < current->applength)
+    {
+        cnet_errno = ER_BADSIZE;
+        return -1;
+    }
+
+    MSGHEADER   header;
+    int         dest = host_of(current->appdest);
+
+    header.source       = current->info.address;
+    header.destination  = current->appdest;
+    header.seq          = current->nextseq[dest]++;
+    header.length       = current->applength;
+    header.created      = now;
+    if(header.seq == current->maxcreated[dest])
+    {
+        current->maxcreated[dest]   = header.seq ? 2*header.seq : 64;
+        current->created[dest]      = realloc(current->created[dest], current->maxcreated[dest] * sizeof(CnetTime));
+    }
+    current->created[dest][header.seq] = now;
+    memcpy(msg, &header, sizeof(header));
+    fill_body((unsigned char *)msg + sizeof(header), current->applength - sizeof(header), &header);
+
+    *destaddr           = current->appdest;
+    *length             = current->applength;
+    current->appready   = false;
+    generated++;
+    return 0;
+}
+
+static void delivery_error(long *counter, const char *what, MSGHEADER *header)
+{
+    if(duplicated + missing + undelivered + misdelivered + damaged < 10)
+        fprintf(stderr, "%s: %s message (src= %i, dest= %i, seq= %u) at %li usec\n",
+                current->info.nodename, what, header->source, header->destination, header->seq, (long)now);
+    (*counter)++;
+}
+
+int CNET_write_application(void *msg, size_t *length)
+{
+    MSGHEADER       header;
+    unsigned char   body[MAX_MESSAGE_SIZE];
+
+    if(*length < sizeof(header) || *length > MAX_MESSAGE_SIZE)
+    {
+        cnet_errno = ER_BADSIZE;
+        return -1;
+    }
+    memcpy(&header, msg, sizeof(header));
+
+    int source = host_of(header.source);
+    if(source == -1 || header.length != *length)
+    {
+        delivery_error(&damaged, "damaged", &header);
+        return 0;
+    }
+    if(header.destination != current->info.address)
+    {
+        delivery_error(&misdelivered, "misdelivered", &header);
+        return 0;
+    }
+    fill_body(body, *length - sizeof(header), &header);
+    if(memcmp(body, (unsigned char *)msg + sizeof(header), *length - sizeof(header)) != 0)
+    {
+        delivery_error(&damaged, "damaged", &header);
+        return 0;
+    }
+    if(header.seq < current->expected[source])
+    {
+        delivery_error(&duplicated, "duplicate", &header);
+        return 0;
+    }
+    if(header.seq > current->expected[source])
+    {
+        delivery_error(&missing, "out of order", &header);
+        missing += header.seq - current->expected[source] - 1;
+    }
+    current->expected[source] = header.seq + 1;
+    current->lastdelivered[source] = now;
+
+    if(delivered == maxlatency)
+    {
+        maxlatency  = maxlatency ? 2*maxlatency : 4096;
+        latency     = realloc(latency, maxlatency * sizeof(CnetTime));
+    }
+    latency[delivered++] = now - header.created;
+    deliveredbytes  += *length;
+    minframes       += hopcount[source*numhosts + current->hostindex];
+    return 0;
+}
+
+static int set_application(CnetAddr destaddr, bool enabled)
+{
+    if(current->info.nodetype != NT_HOST)
+        return 0;           // a router has no application layer to enable
+    if(destaddr == ALLNODES)
+    {
+        for(int h = 0; h < numhosts; h++)
+            current->enabled[h] = enabled && hosts[h] != current->info.nodenumber;
+    }
+    else
+    {
+        int h = host_of(destaddr);
+        if(h == -1)
+        {
+            cnet_errno = ER_BADNODE;
+            return -1;
+        }
+        current->enabled[h] = enabled && hosts[h] != current->info.nodenumber;
+    }
+    if(enabled && current->appwaiting)
+    {
+        current->appwaiting = false;
+        schedule_application(current->info.nodenumber, now);
+    }
+    return 0;
+}
+
+int CNET_enable_application(CnetAddr destaddr)
+{
+    return set_application(destaddr, true);
+}
+
+int CNET_disable_application(CnetAddr destaddr)
+{
+    return set_application(destaddr, false);
+}
+
+CnetTimerID CNET_start_timer(CnetEvent ev, CnetTime usecs, CnetData data)
+{
+    EVENT   e = { .kind = SE_TIMER };
+    int     slot;
+
+    if(ev < EV_TIMER0 || ev > EV_TIMER10)
+    {
+        cnet_errno = ER_BADEVENT;
+        return NULLTIMER;
+    }
+    if(numfree > 0)
+        slot = timerfree[--numfree];
+    else
+    {
+        if(numtimers == maxtimers)
+        {
+            maxtimers   = maxtimers ? 2*maxtimers : 1024;
+            timergen    = realloc(timergen, maxtimers * sizeof(uint32_t));
+            timerowner  = realloc(timerowner, maxtimers * sizeof(int));
+            timerfree   = realloc(timerfree, maxtimers * sizeof(int));
+        }
+        slot = numtimers++;
+        timergen[slot] = 1;
+    }
+    timerowner[slot] = current->info.nodenumber;
+
+    e.time  = now + (usecs > 0 ? usecs : 0);
+    e.node  = current->info.nodenumber;
+    e.ev    = ev;
+    e.timer = (CnetTimerID)timergen[slot] << 32 | (slot + 1);
+    e.data  = data;
+    schedule(&e);
+    return e.timer;
+}
+
+int CNET_stop_timer(CnetTimerID timer)
+{
+    long slot = (timer & 0xffffffff) - 1;
+
+    if(timer == NULLTIMER || slot < 0 || slot >= numtimers || timergen[slot] != (uint32_t)(timer >> 32)
+       || timerowner[slot] != current->info.nodenumber)
+    {
+        cnet_errno = ER_BADTIMERID;
+        return -1;
+    }
+    timergen[slot]++;
+    timerfree[numfree++] = slot;
+    return 0;
+}
+
+//  CRC-CCITT, POLYNOMIAL 0x1021, A BYTE AT A TIME FROM A TABLE BUILT ON FIRST USE, AS CNET DOES
+uint16_t CNET_ccitt(unsigned char *addr, size_t nbytes)
+{
+    static uint16_t table[256];
+    static bool     built = false;
+    uint16_t        crc = 0;
+
+    if(!built)
+    {
+        for(int byte = 0; byte < 256; byte++)
+        {
+            uint16_t value = byte << 8;
+            for(int bit = 0; bit < 8; bit++)
+                value = value & 0x8000 ? (value << 1) ^ 0x1021 : value << 1;
+            table[byte] = value;
+        }
+        built = true;
+    }
+    while(nbytes-- > 0)
+        crc = (crc << 8) ^ table[(crc >> 8) ^ *addr++];
+    return crc;
+}
+
+//  CRC-32, THE REFLECTED POLYNOMIAL 0xEDB88320, A BIT AT A TIME
+uint32_t CNET_crc32(unsigned char *addr, size_t nbytes)
+{
+    uint32_t crc = 0xffffffff;
+
+    while(nbytes-- > 0)
+    {
+        crc ^= *addr++;
+        for(int bit = 0; bit < 8; bit++)
+            crc = crc & 1 ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+    }
+    return ~crc;
+}
+
+//  UNDER -q THE PROTOCOL'S TRACING IS NOT EVEN FORMATTED. THESE TAKE PRECEDENCE OVER THE C LIBRARY'S FOR THE
+//  PROTOCOL, AS THE EXECUTABLE COMES FIRST IN ITS SYMBOL LOOKUP; THE COMPILER TURNS SOME printf()S INTO THE
+//  OTHER TWO
+int printf(const char *format, ...)
+{
+    va_list ap;
+    int     n;
+
+    if(quiet)
+        return 0;
+    va_start(ap, format);
+    n = vprintf(format, ap);
+    va_end(ap);
+    return n;
+}
+
+int puts(const char *s)
+{
+    return quiet ? 0 : fputs(s, stdout) == EOF ? EOF : putchar('\n');
+}
+
+int putchar(int c)
+{
+    return quiet ? c : putc(c, stdout);
+}
+
+char *CNET_getvar(const char *name)
+{
+    for(int i = 0; i < numvars; i++)
+        if(strcmp(vars[i].name, name) == 0)
+            return vars[i].value;
+    return NULL;
+}
+
+void CNET_exit(const char *filename, const char *function, int lineno)
+{
+    fflush(stdout);
+    fprintf(stderr, "%s: %s, %s() line %i, at %li usec: %s\n",
+            current ? current->info.nodename : "cnetsim", filename, function, lineno, (long)now,
+            cnet_errno >= 0 && cnet_errno <= ER_TOOBUSY ? cnet_errname[cnet_errno] : "unknown error");
+    exit(2);
+}
+
+//  ------------------------------------------------------------------------------------------------------
+
+//  A GAP IS ONLY SEEN WHEN A LATER MESSAGE ARRIVES, AND A STALLED CONNECTION DELIVERS NOTHING OUT OF ORDER.
+//  SO AT THE END, A SOURCE AND DESTINATION BETWEEN WHICH NOTHING HAS BEEN DELIVERED FOR grace COUNT EVERY
+//  MESSAGE CREATED BEFORE THEN AND STILL OWED. A CONNECTION THAT IS ONLY SLOW, ITS MESSAGES STILL ARRIVING
+//  BEHIND A LONG QUEUE, IS NOT COUNTED
+static void count_undelivered(CnetTime grace)
+{
+    for(int s = 0; s < numhosts; s++)
+    {
+        NODE *source = &nodes[hosts[s]];
+
+        for(int d = 0; d < numhosts; d++)
+        {
+            NODE    *dest = &nodes[hosts[d]];
+            long    count = 0;
+
+            if(dest->lastdelivered[s] > now - grace)
+                continue;
+            for(uint32_t seq = dest->expected[s]; seq < source->nextseq[d] && source->created[d][seq] <= now - grace; seq++)
+                count++;
+            if(count > 0 && duplicated + missing + undelivered + misdelivered + damaged < 10)
+                fprintf(stderr, "%s: %li message(s) to %s undelivered, the first (seq= %u) created at %li usec, none delivered since %li usec\n",
+                        source->info.nodename, count, dest->info.nodename, dest->expected[s],
+                        (long)source->created[d][dest->expected[s]], (long)(dest->lastdelivered[s] == -1 ? 0 : dest->lastdelivered[s]));
+            undelivered += count;
+        }
+    }
+}
+
+static int compare_time(const void *a, const void *b)
+{
+    CnetTime x = *(const CnetTime *)a, y = *(const CnetTime *)b;
+
+    return (x > y) - (x < y);
+}
+
+static CnetTime percentile(double p)
+{
+    if(delivered == 0)
+        return 0;
+    return latency[(long)(p * (delivered - 1))];
+}
+
+//  THE REPORT AS ONE LINE OF JSON, FOR THE BENCHMARK SCRIPTS IN bench/
+static void print_json(const char *topology, uint64_t seed, char **overrides, int noverrides, double seconds,
+                       long frames, long bytes, CnetTime busy, CnetTime latencysum)
+{
+    double  bandwidth = resolve(A_BANDWIDTH, UNSET, UNSET);
+    double  propagationdelay = resolve(A_PROPAGATIONDELAY, UNSET, UNSET);
+    double  msgsize = (resolve(A_MINMESSAGESIZE, UNSET, UNSET) + resolve(A_MAXMESSAGESIZE, UNSET, UNSET)) / 2;
+
+//  STOP-AND-WAIT OVER ONE LINK CAN KEEP IT BUSY FOR ONE FRAME TIME IN EVERY 1 + 2a, a = PROPAGATION / FRAME TIME
+    double  a = propagationdelay / (msgsize * 8 * 1000000 / bandwidth);
+
+    printf("{\"topology\":\"%s\",\"seed\":%llu,\"overrides\":\"", topology, (unsigned long long)seed);
+    for(int i = 0; i < noverrides; i++)
+        printf("%s%s", i > 0 ? " " : "", overrides[i]);
+    printf("\",\"seconds\":%.0f,\"nodes\":%i,\"hosts\":%i,\"links\":%i", now / 1e6, numnodes, numhosts, numlinks);
+    printf(",\"bandwidth_bps\":%.0f,\"propagationdelay_us\":%.0f,\"probframeloss\":%.0f,\"probframecorrupt\":%.0f,\"msgsize\":%.0f",
+           bandwidth, propagationdelay, resolve(A_PROBFRAMELOSS, UNSET, UNSET), resolve(A_PROBFRAMECORRUPT, UNSET, UNSET), msgsize);
+    printf(",\"events\":%li,\"events_per_sec\":%.0f,\"generated\":%li,\"delivered\":%li,\"errors\":%li,\"undelivered\":%li",
+           events, seconds > 0 ? events / seconds : 0.0, generated, delivered, duplicated + missing + undelivered + misdelivered + damaged,
+           undelivered);
+    printf(",\"goodput_bps\":%.1f,\"link_utilization\":%.5f,\"u_theory\":%.5f",
+           now > 0 ? deliveredbytes * 8e6 / now : 0.0, now > 0 && numlinks > 0 ? busy / (2.0 * numlinks * now) : 0.0, 1 / (1 + 2*a));
+    printf(",\"frames\":%li,\"bytes\":%li,\"data_frames\":%li,\"min_data_frames\":%li,\"retx_ratio\":%.4f",
+           frames, bytes, dataframes, minframes, minframes > 0 ? (double)dataframes / minframes - 1 : 0.0);
+    printf(",\"latency_mean_ms\":%.3f,\"latency_p50_ms\":%.3f,\"latency_p95_ms\":%.3f,\"latency_p99_ms\":%.3f}\n",
+           delivered ? latencysum / (double)delivered / 1000 : 0.0,
+           percentile(0.50) / 1000.0, percentile(0.95) / 1000.0, percentile(0.99) / 1000.0);
+}
+
+static void print_report(const char *topology, uint64_t seed, char **overrides, int noverrides, double seconds)
+{
+    long        frames = 0, bytes = 0, lost = 0, corrupted = 0;
+    CnetTime    busy = 0, latencysum = 0;
+
+    for(int l = 0; l < numlinks; l++)
+    {
+        frames      += links[l].frames[0] + links[l].frames[1];
+        bytes       += links[l].bytes[0] + links[l].bytes[1];
+        busy        += links[l].busy[0] + links[l].busy[1];
+        lost        += links[l].lost;
+        corrupted   += links[l].corrupted;
+    }
+    for(long i = 0; i < delivered; i++)
+        latencysum += latency[i];
+    qsort(latency, delivered, sizeof(CnetTime), compare_time);
+
+    quiet = false;              // the report is printed whatever became of the protocol's output
+    if(json)
+    {
+        print_json(topology, seed, overrides, noverrides, seconds, frames, bytes, busy, latencysum);
+        return;
+    }
+    printf("simulated time       %.3f s\n", now / 1e6);
+    printf("events               %li\n", events);
+    printf("events per second    %.0f\n", seconds > 0 ? events / seconds : 0.0);
+    printf("messages generated   %li\n", generated);
+    printf("messages delivered   %li\n", delivered);
+    printf("delivery errors      %li (duplicate %li, missing %li, undelivered %li, misdelivered %li, damaged %li)\n",
+            duplicated + missing + undelivered + misdelivered + damaged, duplicated, missing, undelivered, misdelivered, damaged);
+    printf("latency mean         %.3f ms\n", delivered ? latencysum / (double)delivered / 1000 : 0.0);
+    printf("latency p50/p95/p99  %.3f / %.3f / %.3f ms\n",
+            percentile(0.50) / 1000.0, percentile(0.95) / 1000.0, percentile(0.99) / 1000.0);
+    printf("frames transmitted   %li (%li bytes, %li lost, %li corrupted)\n", frames, bytes, lost, corrupted);
+    printf("link utilization     %.4f\n", now > 0 && numlinks > 0 ? busy / (2.0 * numlinks * now) : 0.0);
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s [-q] [-j] [-B | -Q] [-s seed] [-T seconds] [-G seconds] [-E events] [-p protocol.so] [-o name=value]... TOPOLOGY\n"
+                    "  -q           discard the protocol's own output, print only the report\n"
+                    "  -j           print the report as one line of JSON\n"
+                    "  -B           refuse a write to a busy link with ER_TOOBUSY, as cnet does (the default)\n"
+                    "  -Q           queue a write to a busy link behind the frame on it instead\n"
+                    "  -s seed      seed of the run (default 1)\n"
+                    "  -T seconds   simulated time to run for (default 600)\n"
+                    "  -G seconds   count messages still owed as errors once nothing has arrived for this long (default 300)\n"
+                    "  -E events    stop after this many events\n"
+                    "  -p file      the protocol, built as a shared object (default ./stopandwait.so)\n"
+                    "  -o name=val  override a topology attribute or var\n", argv0);
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    const char  *protocol = "./stopandwait.so";
+    uint64_t    seed = 1;
+    CnetTime    endtime = 600 * (CnetTime)1000000;
+    CnetTime    grace = 300 * (CnetTime)1000000;
+    long        maxevents = 0;
+    char        *overrides[64];
+    int         noverrides = 0;
+    int         opt;
+
+    while((opt = getopt(argc, argv, "qjBQs:T:G:E:p:o:")) != -1)
+    {
+        switch(opt)
+        {
+        case 'q':   quiet = true;                                   break;
+        case 'j':   json = true;                                    break;
+        case 'B':   queuewrites = false;                            break;
+        case 'Q':   queuewrites = true;                             break;
+        case 's':   seed = strtoull(optarg, NULL, 0);               break;
+        case 'T':   endtime = atof(optarg) * 1000000;               break;
+        case 'G':   grace = atof(optarg) * 1000000;                 break;
+        case 'E':   maxevents = atol(optarg);                       break;
+        case 'p':   protocol = optarg;                              break;
+        case 'o':
+            if(noverrides == 64)
+                usage(argv[0]);
+            overrides[noverrides++] = optarg;
+            break;
+        default:    usage(argv[0]);
+        }
+    }
+    if(optind != argc - 1)
+        usage(argv[0]);
+
+    for(int a = 0; a < N_ATTRS; a++)
+        attr[a] = forced[a] = UNSET;
+    parse_topology(argv[optind]);
+    for(int i = 0; i < noverrides; i++)
+        parse_override(strdup(overrides[i]));
+    build_network();
+    load_protocol(protocol);
+    rngstate = seed;
+
+    struct timespec started, finished;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+
+    for(int n = 0; n < numnodes; n++)
+        dispatch(&nodes[n], EV_REBOOT, NULLTIMER, 0);
+    for(int n = 0; n < numnodes; n++)
+        if(nodes[n].info.nodetype == NT_HOST)
+            schedule_application(n, message_interval(&nodes[n]));
+
+    while(heapsize > 0 && heap[0].time <= endtime && (maxevents == 0 || events < maxevents))
+    {
+        EVENT e = unschedule();
+
+        now = e.time;
+        switch(e.kind)
+        {
+        case SE_TIMER:          timer_event(&e);            break;
+        case SE_FRAME:          frame_event(&e);            break;
+        case SE_APPLICATION:    application_event(e.node);  break;
+        }
+    }
+    if(maxevents == 0 || events < maxevents)
+        now = endtime;
+
+    for(int n = 0; n < numnodes; n++)
+        if(nodes[n].handler[EV_SHUTDOWN] != NULL)
+            dispatch(&nodes[n], EV_SHUTDOWN, NULLTIMER, nodes[n].handlerdata[EV_SHUTDOWN]);
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+    count_undelivered(grace);
+    print_report(argv[optind], seed, overrides, noverrides, (finished.tv_sec - started.tv_sec) + (finished.tv_nsec - started.tv_nsec) / 1e9);
+
+    return duplicated + missing + undelivered + misdelivered + damaged > 0 ? 1 : 0;
+}
@@ -2,487 +2,2829 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "checksum.h"
+#include "fec.h"
+#include "trace.h"
+
+//  TRACING GOES THROUGH LOG, WHICH ONLY FORMATS ITS MESSAGE WHEN level IS AT OR BELOW  var loglevel
+//  ("none", "error", "warn", "info" OR "trace", DEFAULT "info"). BUILT WITH -DNDEBUG IT COMPILES OUT ALTOGETHER
+typedef enum { LOG_NONE, LOG_ERROR, LOG_WARN, LOG_INFO, LOG_TRACE } LOGLEVEL;
+
+LOGLEVEL    loglevel    = LOG_INFO;
+
+#ifdef NDEBUG
+#define LOG(level, ...)     do { } while(0)
+#else
+#define LOG(level, ...)     do { if((level) <= loglevel) printf(__VA_ARGS__); } while(0)
+#endif
 
 //  DATA FRAMES CARRY A MAXIMUM-SIZED PAYLOAD, OUR MESSAGE
 typedef struct {
     char        data[MAX_MESSAGE_SIZE];
 } MSG;
 
-//  THE FORMAT OF A FRAME
-typedef struct {
-//  THE FIRST FIELDS IN THE STRUCTURE DEFINE THE FRAME HEADER
-    CnetAddr    source;	        // source address
-    CnetAddr    destination;	// destination address
-    int         seq;       	    // seq = -1 if the frame carries no data in msg field, else frame 					// carries a message whose sequence number is seq
-    int 	    ack;		    // ack = -1 if the frame carries no ack, else frame carries an ack whose 				// sequence number is ack 
-    size_t	    len;       	    // the length of the msg field only
-    int         checksum;  	    // checksum of the whole frame
-    CnetAddr    hops[7];        // keeps track of all the address the frame has been to
-    int         lenhops;        // number of hops 
+//  THE LONGEST TRAIL OF ADDRESSES A FRAME CARRIES, LATER HOPS ARE SIMPLY NOT RECORDED
+#define MAX_HOPS            7
+
+//  THE KINDS OF FRAME THAT TRAVEL BETWEEN NODES
+typedef enum { DL_DATA, DL_ACK, DL_ROUTING, DL_NAK } FRAMEKIND;
+
+//  THE FORMAT OF A FRAME
+typedef struct {
+//  THE FIRST FIELDS IN THE STRUCTURE DEFINE THE FRAME HEADER
+    FRAMEKIND   kind;           // what the frame carries, DL_ROUTING frames never leave the link they were sent on
+    CnetAddr    source;	        // source address
+    CnetAddr    destination;	// destination address
+    int         seq;       	    // seq = -1 if the frame carries no data in msg field, else frame 					// carries a message whose sequence number is seq
+    int 	    ack;		    // ack = -1 if the frame carries no ack, else frame carries an ack whose 				// sequence number is ack 
+    size_t	    len;       	    // the length of the msg field only
+    bool        batched;        // msg holds several messages, each preceded by its length, see window_send
+    bool        parity;         // msg is the parity of a block of data frames, see fec_flush
+    unsigned short xmit;        // stamped afresh on every (re)transmission by the source, kept by relays
+    uint32_t    checksum;  	    // of the header and hops as last encoded or decoded, see frame_encode
+    CnetAddr    hops[MAX_HOPS]; // keeps track of all the address the frame has been to
+    int         lenhops;        // number of hops 
+
+//  THE LAST FIELD IN THE FRAME IS THE PAYLOAD, OUR MESSAGE
+    MSG          msg;
+
+//  NOT SENT: THE CHECKSUM OF msg ONCE KNOWN, SO THAT NEITHER A RELAY NOR A RETRANSMISSION COMPUTES IT AGAIN
+    uint32_t    payloadsum;
+    bool        payloadsummed;
+
+//  NOT SENT: WHILE A RECEIVED FRAME IS BEING HANDLED, THE BYTES IT ARRIVED AS, WHERE ITS PAYLOAD STAYS UNLESS
+//  IT IS DELIVERED. NULL FOR A FRAME BUILT HERE, WHOSE PAYLOAD IS IN msg
+    unsigned char *wire;
+    size_t      wirelen;
+    size_t      payloadat;      // offset of the payload in wire
+} FRAME;
+
+//  TRAFFIC COUNTERS, KEPT PER CONNECTION, PER ROUTE AND PER LINK AND DUMPED AS JSON BY dump_metrics.
+//  BYTES ARE WIRE BYTES, HEADERS INCLUDED
+typedef struct {
+    long        framessent;
+    long        bytessent;
+    long        framesreceived;
+    long        bytesreceived;
+    long        relayed;        // frames forwarded on behalf of other nodes
+    long        flooded;        // copies written to every link as the way on was not known
+    long        retransmits;
+    long        badchecksums;
+    long        duplicates;     // copies dropped by the duplicate cache, or data outside the receive window
+} STATS;
+
+//  EQUAL-COST MULTIPATH: THE LINKS THAT LEAD SOMEWHERE EQUALLY WELL, AT MOST MAX_ECMP OF THEM
+#define MAX_ECMP            4
+
+typedef struct {
+    int         n;
+    int         link[MAX_ECMP];
+} LINKSET;
+
+typedef struct {
+    CnetAddr    source;
+    CnetAddr    destination;
+    int         incoming_link;
+    LINKSET     outgoing;       // empty until learnt
+    CnetTime    probed;         // when an ACK of the route last went out on another link too
+    int         probelink;      // that other link, 0 before the first
+    STATS       stats;          // frames relayed along this route
+} ROUTES;
+
+//  AN OPEN-ADDRESSED INDEX FROM A KEY TO A POSITION IN ONE OF THE GROWABLE TABLES, NOTHING IS EVER REMOVED
+typedef struct {
+    uint64_t    *keys;
+    int         *values;        // -1 marks an empty slot
+    int         capacity;       // always a power of two
+    int         used;
+} HASHINDEX;
+
+//  THE ROUTING TABLE, INDEXED ON (SOURCE, DESTINATION)
+ROUTES      *routes     = NULL;
+int         numroute    = 0;
+int         maxroute    = 0;
+HASHINDEX   routeindex;
+
+#define ROUTE_KEY(source, destination)	(((uint64_t)(uint32_t)(source) << 32) | (uint32_t)(destination))
+
+//  DISTANCE-VECTOR ROUTING, SELECTED PER TOPOLOGY FILE WITH  var routing = "dv"
+typedef enum { ROUTING_LEARN, ROUTING_DV } ROUTINGMODE;
+
+#define DV_INFINITY         16
+#define DV_EXPIRE           6           // periods a route outlives the last word from its next hop
+#define DV_STABLE           3           // periods without a change before the table counts as converged
+
+ROUTINGMODE routing     = ROUTING_LEARN;
+bool        hostrouting = true;         // hosts run the protocol too, rather than only announcing themselves
+CnetTime    dvperiod    = 5000000;      // usec between periodic updates, var dvperiod is in msec
+
+//  THE DISTANCE-VECTOR TABLE, INDEXED ON THE DESTINATION ADDRESS
+typedef struct {
+    CnetAddr    destination;
+    int         cost;           // hops to the destination, DV_INFINITY once it is unreachable
+    int         link;           // first link on the path, 0 for this node itself
+    LINKSET     links;          // link, and any other link whose neighbour offers the same cost
+    CnetTime    updated;        // when a neighbour on links last confirmed the route
+    STATS       stats;          // frames relayed along this route
+} DVROUTE;
+
+DVROUTE     *dvroutes   = NULL;
+int         numdvroute  = 0;
+int         maxdvroute  = 0;
+HASHINDEX   dvindex;
+CnetTime    dvchanged   = 0;            // when this node's table last changed
+CnetTime    dvconverged = -1;           // dvchanged once it had held for DV_STABLE periods, -1 until then
+int         dvchanges   = 0;
+
+//  DUPLICATE SUPPRESSION, ON UNLESS THE TOPOLOGY FILE SAYS  var dupcache = "0"
+#define DUPCACHE_SETS       256         // a power of two
+#define DUPCACHE_WAYS       4
+
+typedef struct {
+    uint64_t    key;
+    CnetTime    seen;           // when the first copy arrived, 0 if empty
+    CnetTime    used;           // when a copy last arrived, for LRU replacement within the set
+    int         link;           // the first copy arrived on
+} DUPENTRY;
+
+bool        dupcache        = true;
+CnetTime    dupcachetime    = 60000000; // usec a fingerprint is remembered, var dupcachetime is in msec
+DUPENTRY    dupentries[DUPCACHE_SETS][DUPCACHE_WAYS];
+long        dupevictions    = 0;        // fingerprints forgotten before dupcachetime, each may let a copy through
+
+//  EQUAL-COST MULTIPATH, ON BY DEFAULT ONLY UNDER DISTANCE-VECTOR ROUTING, AS A LEARNT ROUTE NEEDS FRAMES TO
+//  COME BACK THE WAY THEY WENT, WHICH ECMP NO LONGER PROMISES. WITH  var ecmp = "1"  A FURTHER COPY OF A FLOODED
+//  FRAME ARRIVING ON ANOTHER LINK WITHIN  var ecmpslack  MSEC OF THE FIRST (DEFAULT 250) CAME AN EQUALLY GOOD
+//  WAY, AND FLOWS BACK TOWARDS ITS SOURCE MAY TAKE EITHER
+bool        ecmp            = false;
+CnetTime    ecmpslack       = 250000;
+
+//  A LEARNT ROUTE IS THE WAY THE FIRST COPY OF A FLOOD HAPPENED TO TAKE, A LONG ONE IF THE COPIES ON THE SHORT
+//  ONE WERE LOST. SO EVERY  var routeprobe  MSEC (DEFAULT 30000) AN ACK ON A ROUTE ALSO GOES OUT ON ONE OTHER
+//  LINK, EACH IN TURN, AND WHEREVER THAT COPY ARRIVES FIRST THE WAY BACK TO THE ACK'S SOURCE MOVES TO IT. ONLY
+//  WITH THE DUPLICATE CACHE, WHICH TELLS A FIRST COPY FROM THE REST
+CnetTime    routeprobe      = 30000000;
+
+//  THE COUNTERS OF EACH LINK, AND WHEN ANY FRAME, CORRUPTED OR NOT, LAST ARRIVED ON IT, INDEXED 0 .. nodeinfo.nlinks
+STATS       *linkstats      = NULL;
+CnetTime    *linkheard      = NULL;
+
+//  A FRAME WRITTEN WHILE ITS LINK IS STILL TRANSMITTING WAITS IN THE QUEUE OF ITS (SOURCE, DESTINATION) FLOW
+//  ON THAT LINK. WHENEVER THE PACING TIMER FINDS THE LINK FREE, THE FLOWS TAKE TURNS BY DEFICIT ROUND-ROBIN,
+//  EACH SENDING UP TO  var quantum  BYTES PER ROUND (DEFAULT 1500). A LINK HOLDS AT MOST  var queuelimit
+//  FRAMES (DEFAULT 64), AND WHEN IT IS FULL THE LONGEST FLOW LOSES ITS OLDEST FRAME
+//
+//  A FRAME COUNTS AS SENT, ON ITS LINK AND FOR THE CONNECTION OR ROUTE IT WENT OUT FOR, ONLY ONCE THE PHYSICAL
+//  LAYER TAKES IT, SO A FRAME DROPPED FROM A FULL QUEUE IS NOT. THE OWNER IS KEPT BY INDEX AS THE TABLES MAY
+//  GROW, AND MOVE, WHILE THE FRAME WAITS
+typedef enum { OWNER_NONE, OWNER_CONN, OWNER_ROUTE, OWNER_DVROUTE } OWNERKIND;
+
+typedef struct {
+    OWNERKIND   kind;
+    int         index;
+} OWNER;
+
+#define NO_OWNER            ((OWNER){ OWNER_NONE, -1 })
+#define CONN_OWNER(i)       ((OWNER){ OWNER_CONN, i })
+#define ROUTE_OWNER(i)      ((OWNER){ OWNER_ROUTE, i })
+#define DVROUTE_OWNER(i)    ((OWNER){ OWNER_DVROUTE, i })
+
+typedef struct QFRAME {
+    struct QFRAME   *next;
+    OWNER           owner;
+    size_t          length;
+    unsigned char   wire[];
+} QFRAME;
+
+typedef struct {
+    CnetAddr    source;
+    CnetAddr    destination;
+    QFRAME      *head;          // oldest frame queued
+    QFRAME      *tail;
+    int         queued;
+    size_t      deficit;        // bytes the flow may still send in its current turn
+    bool        inturn;         // the flow's turn has begun and its quantum was added
+    int         nextactive;     // next flow in the round, -1 ends it
+    long        drops;
+} FLOW;
+
+typedef struct {
+    CnetTime    busyuntil;      // when the frame last written to the link has been transmitted
+    CnetTime    retryat;        // after a refused write, when a frame of its length could have been
+    CnetTime    busytime;       // spent transmitting, in all
+    CnetTimerID pacer;          // EV_TIMER4, running while frames are queued
+    FLOW        *flows;
+    int         numflow;
+    int         maxflow;
+    HASHINDEX   flowindex;      // on ROUTE_KEY(source, destination)
+    int         firstactive;    // the round of flows with frames queued, -1 if none
+    int         lastactive;
+    int         queued;
+    int         peak;
+    long        enqueued;
+    long        drops;
+} LINKQUEUE;
+
+LINKQUEUE   *linkqueues     = NULL;     // indexed 0 .. nodeinfo.nlinks
+int         queuelimit      = 64;
+size_t      quantum         = 1500;
+
+//  A BINARY TRACE OF PROTOCOL EVENTS, ON WITH  var trace = "1". RECORDS COLLECT IN A BUFFER OF  var tracesize
+//  OF THEM THAT IS APPENDED TO  tracefile.nodename.trc  WHENEVER IT FILLS AND AT SHUTDOWN, SEE trace.h
+bool        tracing         = false;
+int         tracesize       = 4096;
+char        tracefile[64]   = "trace";
+TRACEREC    *tracebuf       = NULL;     // NULL unless tracing
+int         tracenext       = 0;
+FILE        *tracefp        = NULL;
+
+//  INITIAL TABLE SIZES, TUNABLE PER TOPOLOGY FILE WITH  var routetablesize = "1024"
+int routetablesize  = 64;
+int conntablesize   = 8;
+
+void hash_init(HASHINDEX *h, int capacity)
+{
+    h->capacity = 1;
+    while(h->capacity < capacity)
+        h->capacity *= 2;
+    h->keys     = malloc(h->capacity * sizeof(uint64_t));
+    h->values   = malloc(h->capacity * sizeof(int));
+    h->used     = 0;
+    for(int i = 0; i < h->capacity; i++)
+        h->values[i] = -1;
+}
+
+//  FIBONACCI HASHING, SO THAT NEARBY ADDRESSES LAND FAR APART
+unsigned int hash_slot(HASHINDEX *h, uint64_t key)
+{
+    return (unsigned int)((key * 0x9E3779B97F4A7C15ULL) >> 32) & (h->capacity - 1);
+}
+
+int hash_find(HASHINDEX *h, uint64_t key)
+{
+    for(unsigned int i = hash_slot(h, key); h->values[i] != -1; i = (i + 1) & (h->capacity - 1))
+    {
+        if(h->keys[i] == key)
+            return h->values[i];
+    }
+    return -1;
+}
+
+void hash_insert(HASHINDEX *h, uint64_t key, int value)
+{
+//  KEEP THE LOAD BELOW 3/4 SO THAT PROBE SEQUENCES STAY SHORT
+    if(4*(h->used + 1) > 3*h->capacity)
+    {
+        HASHINDEX bigger;
+
+        hash_init(&bigger, 2*h->capacity);
+        for(int i = 0; i < h->capacity; i++)
+        {
+            if(h->values[i] != -1)
+                hash_insert(&bigger, h->keys[i], h->values[i]);
+        }
+        free(h->keys);
+        free(h->values);
+        *h = bigger;
+    }
+
+    unsigned int i = hash_slot(h, key);
+    while(h->values[i] != -1)
+        i = (i + 1) & (h->capacity - 1);
+    h->keys[i]      = key;
+    h->values[i]    = value;
+    h->used++;
+}
+
+//  THE ARQ SCHEME, SELECTED PER TOPOLOGY FILE WITH  var arqmode = "gobackn"
+typedef enum { ARQ_STOPANDWAIT, ARQ_GOBACKN, ARQ_SELECTIVEREPEAT } ARQMODE;
+
+#define MAX_WINDOW          8
+#define MAX_QUEUE           8
+
+//  STOP-AND-WAIT KEEPS THE ALTERNATING BIT, THE WINDOWED MODES HAVE 15-BIT SEQNOS. A NETWORK THAT FLOODS, LOOPS
+//  AND QUEUES FRAMES DELIVERS LATE COPIES OF THEM, AND WITH ONLY 2*windowsize SEQNOS SUCH A COPY LANDS IN A LATER
+//  WINDOW AND IS TAKEN FOR A NEW FRAME OR ACK. WITH 32768 A COPY WOULD HAVE TO OUTLIVE THAT MANY FRAMES OF ITS
+//  CONNECTION. STOP-AND-WAIT HAS AT MOST ONE FRAME AND ONE ACK IN FLIGHT, AND RELIES ON THE DUPLICATE CACHE,
+//  WHICH KNOWS EACH COPY BY ITS TRANSMISSION NUMBER, TO DROP LATE COPIES BEFORE THEY REACH IT
+#define SEQ_SPACE           32768
+
+ARQMODE arqmode     = ARQ_STOPANDWAIT;
+int     windowsize  = 1;        // frames that may be outstanding on one connection
+int     maxseq      = 1;        // seqnos run from 0 to maxseq, a multiple of 2*windowsize of them
+
+//  THE CHECKSUM OF EVERY FRAME, SELECTED PER TOPOLOGY FILE WITH  var checksum = "crc32c", SEE checksum.h.
+//  ALL NODES MUST AGREE ON IT
+const CHECKSUM  *cksum      = &checksums[0];
+
+//  HOW LONG AN ACK MAY WAIT FOR DATA GOING THE OTHER WAY, SET IN MSEC WITH  var ackdelay = "10", 0 ACKS AT ONCE
+CnetTime    ackdelay    = 10000;
+int         piggybacked = 0;
+int         standalone  = 0;
+
+//  var aggregate = "1" PACKS AS MANY MESSAGES QUEUED FOR ONE DESTINATION AS FIT INTO ONE DATA FRAME
+bool        aggregate   = false;
+int         batchframes = 0;            // frames sent carrying more than one message
+int         batchmsgs   = 0;            // and the messages they carried
+
+//  FORWARD ERROR CORRECTION, SELECTIVE REPEAT ONLY. var fec = "xor" FOLLOWS EVERY BLOCK OF DATA FRAMES WITH ONE
+//  PARITY FRAME, var fec = "rs" WITH SEVERAL REED-SOLOMON ONES, SEE fec.h, AND THE RECEIVER REBUILDS AS MANY LOST
+//  OR CORRUPTED FRAMES OF THE BLOCK AS IT GOT PARITY FRAMES, SO THAT THEY ARE NEVER RETRANSMITTED. A BLOCK IS
+//  UP TO var fecblock = "4" FRAMES, AND GOES OUT AS FAR AS IT GOT ONCE THE WINDOW IS FULL OR var fecdelay = "500"
+//  MSEC AFTER ITS FIRST FRAME. EACH CONNECTION STARTS AT var fecparity = "2" PARITY FRAMES PER BLOCK AND ADAPTS
+//  ITS RATIO WHILE MORE THAN var fectarget = "5" PERCENT OF ITS FRAMES STILL TIME OUT. ALL NODES MUST AGREE
+#define FEC_PREFIX          3                           // a frame's symbol is its length and batched flag, then its payload
+#define FEC_HEADER(n)       (6 + 4*(n))                 // first seqno unwrapped, frames, parity row, each frame's checksum
+#define FEC_MAX_LEN         (sizeof(MSG) - FEC_HEADER(FEC_MAX_DATA) - FEC_PREFIX)
+#define FEC_SLOT(seqno)     ((seqno) % (2*windowsize))  // a window either side of frameexpected
+
+FECCODE     fec         = FEC_NONE;
+int         fecblock    = 4;
+int         fecparity   = 2;
+int         fectarget   = 5;
+CnetTime    fecdelay    = 500000;
+int         fecsent     = 0;            // parity frames sent
+int         fecrebuilt  = 0;            // data frames rebuilt from them
+
+//  var nak = "1" NAKS A FRAME WHOSE HEADER ARRIVED INTACT BUT WHOSE PAYLOAD DID NOT, SO IT IS RESENT AT ONCE
+bool        nak         = false;
+int         naksent     = 0;
+int         nakresent   = 0;
+
+//  DELIVERY LATENCY, FROM THE APPLICATION HANDING A MESSAGE OVER TO ITS ACK
+CnetTime    latencysum  = 0;
+int         latencies   = 0;
+
+//  RTT SAMPLES ARE BINNED BY POWERS OF TWO OF A MILLISECOND: BUCKET 0 IS UNDER 1 MSEC, BUCKET i FROM
+//  2^(i-1) UP TO 2^i MSEC, AND THE LAST ONE TAKES EVERYTHING LONGER
+#define RTT_BUCKETS         20
+
+//  THE FORMAT OF A CONNECTION
+typedef struct {
+    CnetAddr    destaddress;    // destination of the host with which the connection lies
+    CnetTimerID lasttimer;      // retransmission timer of the oldest outstanding frame
+    int         nextframe;      // seqno of the next frame to be sent
+    int		    ackexpected;    // ack expected
+    int 	    frameexpected;  // seqno of the next frame to be received
+    bool        ackearned;      // a frame has been delivered in order, so there is a cumulative ack to send
+    int         dataxmit;       // stop-and-wait: xmit of the data frame last delivered, -1 before the first
+    int         ackxmit;        // stop-and-wait: xmit of the frame whose ack last moved the window, -1 likewise
+
+//  ROUND-TRIP TIME ESTIMATION (JACOBSON/KARELS), ALL TIMES IN USEC
+    CnetTime    srtt;                       // smoothed round-trip time
+    CnetTime    rttvar;                     // smoothed mean deviation of the round-trip time
+    int         backoff;                    // RTO multiplier, doubled on every timeout
+    int         rttsamples;
+    CnetTime    minrtt;
+    CnetTime    maxrtt;
+    int         rtthist[RTT_BUCKETS];
+
+//  MESSAGES FROM THE APPLICATION WAITING FOR ROOM IN THE SEND WINDOW
+    MSG         *queue[MAX_QUEUE];          // each message is allocated when the application hands it over
+    size_t      queuelen[MAX_QUEUE];
+    CnetTime    queuetime[MAX_QUEUE];
+    int         queuehead;
+    int         queued;
+    bool        throttled;                  // application disabled for destaddress while the queue is full
+
+//  THE SEND AND RECEIVE WINDOWS, STOP-AND-WAIT IS A WINDOW OF ONE
+    int         nbuffered;                  // frames sent but not yet acknowledged
+    FRAME       *sendframe;                 // retransmit copy of each frame as built, slot = seqno % windowsize
+    bool        acked[MAX_WINDOW];          // selective repeat: slot acknowledged out of order
+    CnetTime    sendtime[MAX_WINDOW];       // when the slot was first transmitted
+    CnetTime    xmittime[MAX_WINDOW];       // when the slot was last transmitted
+    CnetTime    queuedat[MAX_WINDOW];       // when the application handed the slot's messages over, summed
+    int         nmsgs[MAX_WINDOW];          // messages in the slot, more than one if it is a batch
+    bool        retransmitted[MAX_WINDOW];  // Karn: never take an RTT sample from a resent frame
+    CnetTimerID sendtimer[MAX_WINDOW];      // selective repeat: one timer per slot
+    int         toofar;                     // one past the upper edge of the receive window
+    MSG         *recvbuf;                   // selective repeat: frames received out of order
+    size_t      recvlen[MAX_WINDOW];
+    bool        recvbatched[MAX_WINDOW];
+    bool        arrived[MAX_WINDOW];
+
+//  FORWARD ERROR CORRECTION: THE BLOCK BEING SENT AND ITS SHAPE, WHAT WAS LAST RECEIVED WITH EACH SEQNO, AND
+//  THE PARITY FRAMES RECEIVED OF THE BLOCK COMING IN
+    uint32_t    fecnext;                    // nextframe, unwrapped: the frames ever sent
+    uint32_t    fecexpected;                // frameexpected, unwrapped: the frames ever received in order
+    uint32_t    fecfirst;                   // unwrapped seqno of the first frame of the block being sent
+    int         fecn;                       // frames in it so far
+    CnetTimerID fectimer;                   // EV_TIMER5, sends the parity of a block that did not fill up
+    int         feck;                       // frames per block
+    int         fecm;                       // parity frames per block
+    int         fecloss;                    // timeouts per thousand frames sent, smoothed
+    CnetTime    fecadapted;                 // when feck or fecm last changed
+    MSG         *fecstore;                  // payload last received with each seqno, at FEC_SLOT(seqno)
+    size_t      feclen[2*MAX_WINDOW];
+    bool        fecbatched[2*MAX_WINDOW];
+    uint32_t    fecsum[2*MAX_WINDOW];
+    MSG         *fecparitybuf;              // FEC_MAX_PARITY of them
+    int         fecrows[FEC_MAX_PARITY];
+    int         fecnparity;
+    size_t      fecparitylen;
+    unsigned char fecblockid[FEC_HEADER(FEC_MAX_DATA)];     // the header of the parity held, less its row
+
+//  AN ACK OWED TO destaddress, SENT ON THE NEXT DATA FRAME TO IT OR ALONE WHEN acktimer EXPIRES
+    bool        ackpending;
+    CnetTimerID acktimer;
+    int         acklink;                    // link the frame being acknowledged arrived on
+
+    STATS       stats;                      // frames of this connection's own traffic, both ways
+} CONN;
+
+//  THE ACK OF A CONNECTION IS CUMULATIVE, IT NAMES THE LAST FRAME DELIVERED IN ORDER. UNTIL ONE HAS BEEN THERE
+//  IS NONE, AND A FRAME CARRIES NO ACK RATHER THAN ONE NAMING A SEQNO THAT WAS NEVER RECEIVED
+#define CUMULATIVE_ACK(c)   ((c)->ackearned ? ((c)->frameexpected + maxseq) % (maxseq + 1) : -1)
+
+//  THE CONNECTION TABLE, INDEXED ON THE DESTINATION ADDRESS
+CONN        *conn       = NULL;
+int         numconn     = 0;
+int         maxconn     = 0;
+HASHINDEX   connindex;
+
+//  READ THE ARQ SCHEME AND WINDOW SIZE FROM THE TOPOLOGY FILE, DEFAULTING TO STOP-AND-WAIT
+void read_config()
+{
+    char *value;
+
+    if((value = CNET_getvar("loglevel")) != NULL)
+    {
+        const char *levels[] = { "none", "error", "warn", "info", "trace" };
+
+        for(int level = LOG_NONE; level <= LOG_TRACE; level++)
+        {
+            if(strcmp(value, levels[level]) == 0)
+                loglevel = level;
+        }
+    }
+
+    if((value = CNET_getvar("trace")) != NULL)
+        tracing = atoi(value) != 0;
+    if((value = CNET_getvar("tracesize")) != NULL && atoi(value) > 0)
+        tracesize = atoi(value);
+    if((value = CNET_getvar("tracefile")) != NULL)
+        snprintf(tracefile, sizeof(tracefile), "%s", value);
+
+    if((value = CNET_getvar("arqmode")) != NULL)
+    {
+        if(strcmp(value, "gobackn") == 0)
+            arqmode = ARQ_GOBACKN;
+        else if(strcmp(value, "selectiverepeat") == 0)
+            arqmode = ARQ_SELECTIVEREPEAT;
+        else
+            arqmode = ARQ_STOPANDWAIT;
+    }
+    if(arqmode != ARQ_STOPANDWAIT && (value = CNET_getvar("windowsize")) != NULL)
+        windowsize = atoi(value);
+    if(arqmode == ARQ_STOPANDWAIT || windowsize < 1)
+        windowsize = 1;
+    if(windowsize > MAX_WINDOW)
+        windowsize = MAX_WINDOW;
+//  slot = seqno % windowsize, AND FEC_SLOT, MUST NOT JUMP AS SEQNOS WRAP
+    maxseq = arqmode == ARQ_STOPANDWAIT ? 1 : SEQ_SPACE / (2*windowsize) * (2*windowsize) - 1;
+
+    if((value = CNET_getvar("ackdelay")) != NULL && atoi(value) >= 0)
+        ackdelay = (CnetTime)atoi(value) * 1000;
+    if((value = CNET_getvar("nak")) != NULL)
+        nak = atoi(value) != 0;
+    if((value = CNET_getvar("aggregate")) != NULL)
+        aggregate = atoi(value) != 0;
+    if((value = CNET_getvar("checksum")) != NULL && checksum_find(value) != NULL)
+        cksum = checksum_find(value);
+
+    if(arqmode == ARQ_SELECTIVEREPEAT && (value = CNET_getvar("fec")) != NULL)
+        fec = strcmp(value, "xor") == 0 ? FEC_XOR : strcmp(value, "rs") == 0 ? FEC_RS : FEC_NONE;
+    if((value = CNET_getvar("fecblock")) != NULL && atoi(value) > 0)
+        fecblock = atoi(value);
+    if(fecblock > windowsize)
+        fecblock = windowsize;
+    if(fecblock > FEC_MAX_DATA)
+        fecblock = FEC_MAX_DATA;
+    if((value = CNET_getvar("fecparity")) != NULL && atoi(value) > 0)
+        fecparity = atoi(value) < FEC_MAX_PARITY ? atoi(value) : FEC_MAX_PARITY;
+    if(fec == FEC_XOR)
+        fecparity = 1;
+    if((value = CNET_getvar("fectarget")) != NULL && atoi(value) > 0)
+        fectarget = atoi(value);
+    if((value = CNET_getvar("fecdelay")) != NULL && atoi(value) > 0)
+        fecdelay = (CnetTime)atoi(value) * 1000;
+
+    if((value = CNET_getvar("routing")) != NULL && strcmp(value, "dv") == 0)
+        routing = ROUTING_DV;
+    if((value = CNET_getvar("hostrouting")) != NULL)
+        hostrouting = atoi(value) != 0;
+    if((value = CNET_getvar("dvperiod")) != NULL && atoi(value) > 0)
+        dvperiod = (CnetTime)atoi(value) * 1000;
+
+    if((value = CNET_getvar("dupcache")) != NULL)
+        dupcache = atoi(value) != 0;
+    if((value = CNET_getvar("dupcachetime")) != NULL && atoi(value) > 0)
+        dupcachetime = (CnetTime)atoi(value) * 1000;
+    ecmp = routing == ROUTING_DV;
+    if((value = CNET_getvar("ecmp")) != NULL)
+        ecmp = atoi(value) != 0;
+    if((value = CNET_getvar("ecmpslack")) != NULL && atoi(value) >= 0)
+        ecmpslack = (CnetTime)atoi(value) * 1000;
+    if((value = CNET_getvar("routeprobe")) != NULL && atoi(value) > 0)
+        routeprobe = (CnetTime)atoi(value) * 1000;
+
+    if((value = CNET_getvar("queuelimit")) != NULL && atoi(value) > 0)
+        queuelimit = atoi(value);
+    if((value = CNET_getvar("quantum")) != NULL && atoi(value) > 0)
+        quantum = atoi(value);
+
+    if((value = CNET_getvar("routetablesize")) != NULL && atoi(value) > 0)
+        routetablesize = atoi(value);
+    if((value = CNET_getvar("conntablesize")) != NULL && atoi(value) > 0)
+        conntablesize = atoi(value);
+}
+
+void initialize_connections()
+{
+    maxconn = conntablesize;
+    conn    = malloc(maxconn * sizeof(CONN));
+    numconn = 0;
+    hash_init(&connindex, 2*conntablesize);
+}
+
+void initialize_routes()
+{
+    maxroute    = routetablesize;
+    routes      = malloc(maxroute * sizeof(ROUTES));
+    numroute    = 0;
+    hash_init(&routeindex, 2*routetablesize);
+}
+
+int check_conn(int destaddr)
+{
+    return hash_find(&connindex, (uint32_t)destaddr);
+}
+
+bool linkset_has(LINKSET *s, int link)
+{
+    for(int i = 0; i < s->n; i++)
+    {
+        if(s->link[i] == link)
+            return true;
+    }
+    return false;
+}
+
+void linkset_add(LINKSET *s, int link)
+{
+    if(link != -1 && s->n < MAX_ECMP && !linkset_has(s, link))
+        s->link[s->n++] = link;
+}
+
+void linkset_remove(LINKSET *s, int link)
+{
+    for(int i = 0; i < s->n; i++)
+    {
+        if(s->link[i] == link)
+        {
+            s->link[i] = s->link[--s->n];
+            return;
+        }
+    }
+}
+
+//  THE LINK OF A SET THAT THE FLOW FROM source TO destination TAKES, -1 IF THE SET IS EMPTY. HASHING ON THE
+//  FLOW KEEPS ITS FRAMES ON ONE PATH, AND SO IN ORDER, WHILE DIFFERENT FLOWS SPREAD OVER ALL OF THEM
+int linkset_pick(LINKSET *s, CnetAddr source, CnetAddr destination)
+{
+    if(s->n <= 1)
+        return s->n == 0 ? -1 : s->link[0];
+    uint64_t h = ROUTE_KEY(source, destination);
+
+//  THE SPLITMIX64 FINALIZER, SO THAT EVERY BIT OF BOTH ADDRESSES REACHES THE LOW BITS THE CHOICE IS MADE FROM
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return s->link[(h ^ (h >> 31)) % s->n];
+}
+
+int check_route(CnetAddr source, CnetAddr destination)
+{
+    return hash_find(&routeindex, ROUTE_KEY(source, destination));
+}
+
+int check_incoming(CnetAddr source, CnetAddr destination)
+{
+    int route = check_route(source, destination);
+    return route == -1 ? -1 : routes[route].incoming_link;
+}
+
+int check_outgoing(CnetAddr source, CnetAddr destination)
+{
+    int route = check_route(source, destination);
+    return route == -1 ? -1 : linkset_pick(&routes[route].outgoing, source, destination);
+}
+
+//  THIS NODE TAKES PART IN THE DISTANCE-VECTOR EXCHANGE, AND NOT JUST BY ANNOUNCING ITS OWN ADDRESS
+bool dv_participating()
+{
+    return routing == ROUTING_DV && (nodeinfo.nodetype == NT_ROUTER || hostrouting);
+}
+
+//  RECORD A ROUTE TO destination COSTING cost THROUGH link, RETURN TRUE IF THE TABLE CHANGED
+bool dv_update(CnetAddr destination, int cost, int link)
+{
+    int route = hash_find(&dvindex, (uint32_t)destination);
+
+    if(cost > DV_INFINITY)
+        cost = DV_INFINITY;
+    if(route == -1)
+    {
+        if(cost == DV_INFINITY)
+            return false;
+        if(numdvroute == maxdvroute)
+        {
+            maxdvroute  *= 2;
+            dvroutes    = realloc(dvroutes, maxdvroute * sizeof(DVROUTE));
+        }
+        route = numdvroute++;
+        hash_insert(&dvindex, (uint32_t)destination, route);
+        dvroutes[route].destination = destination;
+        dvroutes[route].cost        = DV_INFINITY;
+        dvroutes[route].link        = link;
+        dvroutes[route].links.n     = 0;
+        memset(&dvroutes[route].stats, 0, sizeof(STATS));
+    }
+
+    DVROUTE *r = &dvroutes[route];
+    if(linkset_has(&r->links, link))
+    {
+        r->updated = nodeinfo.time_in_usec;
+        if(r->cost == cost)
+            return false;
+//  ONE OF SEVERAL EQUAL NEXT HOPS GOT WORSE: THE OTHERS STILL OFFER THE COST, SO IT JUST LEAVES THE SET
+        if(cost > r->cost && r->links.n > 1)
+        {
+            linkset_remove(&r->links, link);
+            r->link = r->links.link[0];
+            return false;
+        }
+//  OTHERWISE THE NEXT HOP IS BELIEVED WHETHER THE ROUTE GOT BETTER OR WORSE
+    }
+    else if(ecmp && cost == r->cost && cost < DV_INFINITY && link != 0)
+    {
+        linkset_add(&r->links, link);
+        r->updated = nodeinfo.time_in_usec;
+        return false;
+    }
+    else if(cost >= r->cost)
+        return false;
+
+    r->cost     = cost;
+    r->link     = link;
+    r->links.n  = 0;
+    linkset_add(&r->links, link);
+    r->updated  = nodeinfo.time_in_usec;
+    dvchanged   = nodeinfo.time_in_usec;
+    dvchanges++;
+    return true;
+}
+
+//  THE DISTANCE-VECTOR ROUTE THIS NODE USES TOWARDS destination, OR -1 IF IT HAS NO USABLE ONE
+int dv_route(CnetAddr destination)
+{
+    if(!dv_participating())
+        return -1;
+
+    int route = hash_find(&dvindex, (uint32_t)destination);
+    if(route == -1 || dvroutes[route].cost == DV_INFINITY || dvroutes[route].link == 0)
+        return -1;
+    return route;
+}
+
+//  THE LINK THE DISTANCE-VECTOR TABLE CHOOSES FOR THE FLOW FROM source TO destination, OR -1 IF IT HAS NO
+//  USABLE ROUTE
+int dv_link(CnetAddr source, CnetAddr destination)
+{
+    int route = dv_route(destination);
+    return route == -1 ? -1 : linkset_pick(&dvroutes[route].links, source, destination);
+}
+
+//  THE LINK TOWARDS destination FROM THIS NODE, OR -1 IF FRAMES FOR IT HAVE TO BE FLOODED
+int next_link(CnetAddr destination)
+{
+    int link = dv_link(nodeinfo.address, destination);
+    return link != -1 ? link : check_outgoing(nodeinfo.address, destination);
+}
+
+//  THE DISTANCE-VECTOR TABLE STARTS OUT KNOWING ONLY THIS NODE ITSELF
+void initialize_dv()
+{
+    maxdvroute  = routetablesize;
+    dvroutes    = malloc(maxdvroute * sizeof(DVROUTE));
+    numdvroute  = 0;
+    hash_init(&dvindex, 2*routetablesize);
+    dv_update(nodeinfo.address, 0, 0);
+}
+
+//  APPEND A ROUTE, GROWING THE TABLE WHEN IT IS FULL, AND RETURN ITS INDEX
+int add_route(CnetAddr source, CnetAddr destination, int incoming_link, int outgoing_link)
+{
+    if(numroute == maxroute)
+    {
+        maxroute    *= 2;
+        routes      = realloc(routes, maxroute * sizeof(ROUTES));
+    }
+    routes[numroute].source         = source;
+    routes[numroute].destination    = destination;
+    routes[numroute].incoming_link  = incoming_link;
+    routes[numroute].outgoing.n     = 0;
+    linkset_add(&routes[numroute].outgoing, outgoing_link);
+    routes[numroute].probed         = nodeinfo.time_in_usec;
+    routes[numroute].probelink      = 0;
+    memset(&routes[numroute].stats, 0, sizeof(STATS));
+    hash_insert(&routeindex, ROUTE_KEY(source, destination), numroute);
+    return numroute++;
+}
+
+//  A COPY OF A FRAME FROM source TO destination ARRIVED ON link AS EARLY AS THE FIRST, SO link LEADS BACK TO
+//  source AS WELL AS THE LINK THE FIRST CAME IN ON, AND FRAMES FROM destination TO source MAY TAKE EITHER
+void learn_alternative(CnetAddr source, CnetAddr destination, int link)
+{
+    int reverse = check_route(source, destination);
+    if(reverse == -1)
+        return;
+
+    int route = check_route(destination, source);
+    if(route == -1)
+        route = add_route(destination, source, -1, -1);
+    linkset_add(&routes[route].outgoing, routes[reverse].incoming_link);
+    linkset_add(&routes[route].outgoing, link);
+}
+
+//  THE FIRST COPY OF A FRAME FROM source TO destination ARRIVED ON link. IF THE WAY BACK TO source WAS LEARNT
+//  AS ANOTHER LINK, source HAS MOVED TO ANOTHER PATH OR A PROBE FOUND A QUICKER ONE, AND THE ROUTE FOLLOWS
+void follow_route(CnetAddr source, CnetAddr destination, int link)
+{
+    int route = check_route(source, destination);
+    int reverse = check_route(destination, source);
+
+    if(route != -1 && routes[route].incoming_link != -1)
+        routes[route].incoming_link = link;
+    if(reverse != -1 && routes[reverse].outgoing.n > 0 && !linkset_has(&routes[reverse].outgoing, link))
+    {
+        routes[reverse].outgoing.n = 0;
+        linkset_add(&routes[reverse].outgoing, link);
+    }
+}
+
+//  THE LINK AN ACK ON route SHOULD ALSO GO OUT ON, AS IT IS TIME TO PROBE, OR -1. incoming IS -1 AT THE ACK'S SOURCE
+int probe_link(int route, int incoming, int outgoing)
+{
+    if(!dupcache || routing != ROUTING_LEARN || route == -1 || nodeinfo.nlinks < (incoming == -1 ? 2 : 3))
+        return -1;
+
+    ROUTES *r = &routes[route];
+    if(nodeinfo.time_in_usec - r->probed < routeprobe)
+        return -1;
+    r->probed = nodeinfo.time_in_usec;
+    do
+        r->probelink = r->probelink % nodeinfo.nlinks + 1;
+    while(r->probelink == incoming || r->probelink == outgoing);
+    return r->probelink;
+}
+
+//  A FINGERPRINT OF ONE TRANSMISSION OF A FRAME, THE SAME FOR EVERY FLOODED COPY OF IT.
+//  THE CHECKSUM CANNOT BE PART OF IT, AS IT CHANGES WITH THE HOP LIST ON EVERY RELAY
+uint64_t dup_key(FRAME *frame)
+{
+    uint64_t key = 0xcbf29ce484222325ULL;
+
+    key = (key ^ (uint32_t)frame->source)      * 0x100000001b3ULL;
+    key = (key ^ (uint32_t)frame->destination) * 0x100000001b3ULL;
+    key = (key ^ (uint32_t)frame->kind)        * 0x100000001b3ULL;
+    key = (key ^ (uint32_t)frame->seq)         * 0x100000001b3ULL;
+    key = (key ^ (uint32_t)frame->ack)         * 0x100000001b3ULL;
+    key = (key ^ frame->xmit)                  * 0x100000001b3ULL;
+    return key;
+}
+
+//  RETURN TRUE IF THIS TRANSMISSION WAS ALREADY SEEN RECENTLY, REMEMBERING IT OTHERWISE. A COPY THAT ARRIVED
+//  ON ANOTHER LINK NO LATER THAN ecmpslack AFTER THE FIRST IS LEARNT AS AN EQUAL-COST WAY BACK TO ITS SOURCE.
+//  THE CACHE IS 4-WAY SET-ASSOCIATIVE: A NEW FINGERPRINT TAKES AN EMPTY OR EXPIRED WAY OF ITS SET IF THERE IS
+//  ONE, AND ONLY OTHERWISE THE LEAST RECENTLY USED, WHICH IS COUNTED AS AN EVICTION
+bool dup_seen(FRAME *frame, int link)
+{
+    uint64_t    key = dup_key(frame);
+    DUPENTRY    *set = dupentries[(key >> 32) & (DUPCACHE_SETS - 1)];
+    DUPENTRY    *victim = NULL;
+
+    for(int w = 0; w < DUPCACHE_WAYS; w++)
+    {
+        DUPENTRY *e = &set[w];
+
+        if(e->seen == 0 || nodeinfo.time_in_usec - e->seen > dupcachetime)
+        {
+            if(victim == NULL || victim->seen != 0)
+                victim = e;
+            continue;
+        }
+        if(e->key == key)
+        {
+            if(ecmp && link != e->link && nodeinfo.time_in_usec - (e->seen - 1) <= ecmpslack)
+                learn_alternative(frame->source, frame->destination, link);
+            e->used = nodeinfo.time_in_usec;
+            return true;
+        }
+    }
+    if(victim == NULL)
+    {
+        victim = &set[0];
+        for(int w = 1; w < DUPCACHE_WAYS; w++)
+            if(set[w].used < victim->used)
+                victim = &set[w];
+        dupevictions++;
+    }
+    victim->key  = key;
+    victim->seen = nodeinfo.time_in_usec + 1;   // never 0, which marks an empty entry
+    victim->used = nodeinfo.time_in_usec;
+    victim->link = link;
+    return false;
+}
+
+bool check_hops(FRAME *frame)
+{
+    for(int i = 0; i < frame->lenhops; i++)
+    {
+        if(frame->hops[i] == nodeinfo.address)
+            return true;
+    }
+    return false;
+}
+
+//  SOME HELPFUL MACROS FOR COMMON CALCULATIONS
+//  THE HEADER OF THE FRAME STRUCTURE AS IT WAS ONCE WRITTEN TO THE WIRE WHOLE, SOURCE TO lenhops WITH SEVEN HOPS,
+//  WHICH THE COMPACT WIRE FORMAT IS MEASURED AGAINST. offsetof(FRAME, msg) HAS GROWN WITH kind, batched, parity AND xmit
+#define STRUCT_HEADER_SIZE	60
+#define increment(seq)		seq = (seq + 1) % (maxseq + 1)
+
+//  THE WIRE FORMAT OF A FRAME, ALL MULTI-BYTE FIELDS LITTLE-ENDIAN WHATEVER THE HOST:
+//
+//      flags               1 byte, WIRE_KIND | WIRE_SEQ | WIRE_ACK | WIRE_DATA | WIRE_HOPS | WIRE_BATCH | WIRE_PARITY
+//      source              varint, zigzag-encoded
+//      destination         varint, zigzag-encoded
+//      xmit                2 bytes
+//      seq                 2 bytes, only if WIRE_SEQ
+//      ack                 2 bytes, only if WIRE_ACK
+//      len                 varint, only if WIRE_DATA
+//      lenhops             1 byte, only if WIRE_HOPS
+//      checksum            2 bytes (4 for CRC-32C), of the header above and the hops below
+//      payload             len bytes, with WIRE_BATCH a varint length before each message in it, with
+//                          WIRE_PARITY the parity of a block of data frames as laid out by fec_flush
+//      hops                lenhops zigzag varints, after the payload so that a relay can append to them
+//      payload checksum    2 bytes (4 for CRC-32C), of the payload alone, only if WIRE_DATA
+//
+//  WITH ITS OWN CHECKSUM THE HEADER CAN BE TRUSTED WHEN ONLY THE PAYLOAD WAS CORRUPTED, SO THAT THE
+//  FRAME CAN BE NAKED. A RELAY THAT APPENDS A HOP ONLY CHECKSUMS THE HEADER AGAIN
+//  A PURE ACK BETWEEN TWO-BYTE ADDRESSES IS 11 BYTES, 13 WITH A SELECTIVE ACK, WHERE THE FRAME STRUCTURE'S HEADER IS 60
+#define WIRE_KIND           0x03
+#define WIRE_SEQ            0x04
+#define WIRE_ACK            0x08
+#define WIRE_DATA           0x10
+#define WIRE_HOPS           0x20
+#define WIRE_BATCH          0x40
+#define WIRE_PARITY         0x80
+
+#define MAX_VARINT          5
+#define MAX_CHECKSUM        4
+#define MAX_WIRE_HEADER     (1 + 2*MAX_VARINT + 2 + 4 + 3 + 1 + MAX_CHECKSUM)
+#define MAX_WIRE_SIZE       (MAX_WIRE_HEADER + sizeof(MSG) + MAX_VARINT*MAX_HOPS + MAX_CHECKSUM)
+
+#define ZIGZAG(n)           (((uint32_t)(n) << 1) ^ (uint32_t)((int32_t)(n) >> 31))
+#define UNZIGZAG(z)         ((int32_t)((z) >> 1) ^ -(int32_t)((z) & 1))
+
+//  HEADER BYTES ACTUALLY SENT, AGAINST WHAT THE FRAME STRUCTURE'S HEADER WOULD HAVE COST
+long        wireheaderbytes     = 0;
+long        structheaderbytes   = 0;
+
+//  EVERY TIME THE PROTOCOL COPIES A PAYLOAD, AND EVERY FRAME IT RELAYS (HOWEVER MANY LINKS IT GOES OUT ON)
+long        payloadcopies       = 0;
+long        framesrelayed       = 0;
+
+//  A CHECKSUM TAKES cksum->bytes BYTES ON THE WIRE, LITTLE-ENDIAN
+unsigned char *put_sum(unsigned char *p, uint32_t sum)
+{
+    for(int i = 0; i < cksum->bytes; i++, sum >>= 8)
+        *p++ = sum & 0xff;
+    return p;
+}
+
+uint32_t get_sum(unsigned char *p)
+{
+    uint32_t sum = 0;
+
+    for(int i = cksum->bytes - 1; i >= 0; i--)
+        sum = (sum << 8) | p[i];
+    return sum;
+}
+
+//  WHAT frame_decode MADE OF THE BYTES IT WAS GIVEN
+typedef enum { WIRE_OK, WIRE_BADHEADER, WIRE_BADPAYLOAD } WIRESTATUS;
+
+unsigned char *put_varint(unsigned char *p, uint32_t value)
+{
+    while(value >= 0x80)
+    {
+        *p++    = (value & 0x7f) | 0x80;
+        value   >>= 7;
+    }
+    *p++ = value;
+    return p;
+}
+
+//  RETURN WHERE THE VARINT ENDS, OR NULL IF IT RUNS PAST end OR IS TOO LONG
+unsigned char *get_varint(unsigned char *p, unsigned char *end, uint32_t *value)
+{
+    *value = 0;
+    for(int shift = 0; p < end && shift < 7*MAX_VARINT; shift += 7)
+    {
+        *value |= (uint32_t)(*p & 0x7f) << shift;
+        if((*p++ & 0x80) == 0)
+            return p;
+    }
+    return NULL;
+}
+
+//  SERIALIZE A FRAME INTO wire, FILLING IN ITS CHECKSUM, AND RETURN THE NUMBER OF BYTES
+size_t frame_encode(FRAME *frame, unsigned char *wire)
+{
+    unsigned char   *p = wire + 1;
+    unsigned char   flags = frame->kind & WIRE_KIND;
+
+    p = put_varint(p, ZIGZAG(frame->source));
+    p = put_varint(p, ZIGZAG(frame->destination));
+    *p++ = frame->xmit & 0xff;
+    *p++ = frame->xmit >> 8;
+    if(frame->seq != -1)
+    {
+        flags |= WIRE_SEQ;
+        *p++ = frame->seq & 0xff;
+        *p++ = frame->seq >> 8;
+    }
+    if(frame->ack != -1)
+    {
+        flags |= WIRE_ACK;
+        *p++ = frame->ack & 0xff;
+        *p++ = frame->ack >> 8;
+    }
+    if(frame->len > 0)
+    {
+        flags |= WIRE_DATA | (frame->batched ? WIRE_BATCH : 0) | (frame->parity ? WIRE_PARITY : 0);
+        p = put_varint(p, frame->len);
+    }
+    if(frame->lenhops > 0)
+    {
+        flags |= WIRE_HOPS;
+        *p++ = frame->lenhops;
+    }
+    wire[0] = flags;
+    unsigned char *headersum = p;
+    p += cksum->bytes;
+
+    memcpy(p, &frame->msg, frame->len);
+    payloadcopies += frame->len > 0;
+    p += frame->len;
+    unsigned char *hops = p;
+    for(int i = 0; i < frame->lenhops; i++)
+        p = put_varint(p, ZIGZAG(frame->hops[i]));
+    frame->checksum = cksum->fn(cksum->fn(0, wire, headersum - wire), hops, p - hops);
+    put_sum(headersum, frame->checksum);
+    if(frame->len == 0)
+        return p - wire;
+
+    if(!frame->payloadsummed)
+    {
+        frame->payloadsum       = cksum->fn(0, (unsigned char *)&frame->msg, frame->len);
+        frame->payloadsummed    = true;
+    }
+    p = put_sum(p, frame->payloadsum);
+    return p - wire;
+}
+
+//  DESERIALIZE THE HEADER OF length BYTES OF wire INTO A FRAME, LEAVING THE PAYLOAD WHERE IT IS, SO wire MUST
+//  OUTLIVE THE FRAME'S HANDLING. AFTER WIRE_BADPAYLOAD ONLY THE HEADER FIELDS ARE VALID
+WIRESTATUS frame_decode(unsigned char *wire, size_t length, FRAME *frame)
+{
+    unsigned char   *p = wire + 1;
+    unsigned char   *end = wire + length;
+    uint32_t        value;
+
+    if(length < 3)
+        return WIRE_BADHEADER;
+
+    unsigned char flags = wire[0];
+    frame->kind = flags & WIRE_KIND;
+    if((p = get_varint(p, end, &value)) == NULL)
+        return WIRE_BADHEADER;
+    frame->source = UNZIGZAG(value);
+    if((p = get_varint(p, end, &value)) == NULL)
+        return WIRE_BADHEADER;
+    frame->destination = UNZIGZAG(value);
+    if(end - p < 2)
+        return WIRE_BADHEADER;
+    frame->xmit = p[0] | (p[1] << 8);
+    p += 2;
+
+    frame->seq = frame->ack = -1;
+    if(flags & WIRE_SEQ)
+    {
+        if(end - p < 2 || (p[0] | (p[1] << 8)) > maxseq)
+            return WIRE_BADHEADER;
+        frame->seq = p[0] | (p[1] << 8);
+        p += 2;
+    }
+    if(flags & WIRE_ACK)
+    {
+        if(end - p < 2 || (p[0] | (p[1] << 8)) > maxseq)
+            return WIRE_BADHEADER;
+        frame->ack = p[0] | (p[1] << 8);
+        p += 2;
+    }
+    frame->len = 0;
+    frame->batched = (flags & WIRE_BATCH) != 0;
+    frame->parity = (flags & WIRE_PARITY) != 0;
+    if(flags & WIRE_DATA)
+    {
+        if((p = get_varint(p, end, &value)) == NULL || value > sizeof(MSG))
+            return WIRE_BADHEADER;
+        frame->len = value;
+    }
+    frame->lenhops = 0;
+    if(flags & WIRE_HOPS)
+    {
+        if(p == end || *p > MAX_HOPS)
+            return WIRE_BADHEADER;
+        frame->lenhops = *p++;
+    }
+
+//  THE HOPS LIE BETWEEN THE PAYLOAD AND ITS CHECKSUM, AND ARE CHECKED WITH THE HEADER
+    unsigned char *headersum = p;
+    unsigned char *payloadend = frame->len > 0 ? end - cksum->bytes : end;
+    p += cksum->bytes;
+    if(payloadend < p || (size_t)(payloadend - p) < frame->len)
+        return WIRE_BADHEADER;
+    unsigned char *hops = p + frame->len;
+    frame->checksum = get_sum(headersum);
+    if(cksum->fn(cksum->fn(0, wire, headersum - wire), hops, payloadend - hops) != frame->checksum)
+        return WIRE_BADHEADER;
+    for(int i = 0; i < frame->lenhops; i++)
+    {
+        if((hops = get_varint(hops, payloadend, &value)) == NULL)
+            return WIRE_BADHEADER;
+        frame->hops[i] = UNZIGZAG(value);
+    }
+    if(hops != payloadend)
+        return WIRE_BADHEADER;
+
+//  FROM HERE ON THE HEADER IS TRUSTED, AND ANY DAMAGE IS TO THE PAYLOAD
+    frame->wire         = wire;
+    frame->wirelen      = length;
+    frame->payloadat    = p - wire;
+    frame->payloadsummed = false;
+    if(frame->len > 0)
+    {
+        frame->payloadsum = get_sum(payloadend);
+        if(cksum->fn(0, p, frame->len) != frame->payloadsum)
+            return WIRE_BADPAYLOAD;
+        frame->payloadsummed = true;
+    }
+    return WIRE_OK;
+}
+
+//  WHERE THE PAYLOAD OF A FRAME IS: STILL IN THE BYTES IT ARRIVED AS, OR IN msg IF IT WAS BUILT HERE
+unsigned char *frame_payload(FRAME *frame)
+{
+    return frame->wire != NULL ? frame->wire + frame->payloadat : (unsigned char *)&frame->msg;
+}
+
+//  APPEND THIS NODE TO THE HOP LIST OF A RECEIVED FRAME, IN PLACE. THE HOPS FOLLOW THE PAYLOAD, SO ONLY THEIR
+//  COUNT, THE PAYLOAD CHECKSUM BEHIND THEM AND THE HEADER CHECKSUM CHANGE. wire HAS ROOM, BEING MAX_WIRE_SIZE
+void patch_hop(FRAME *frame, CnetAddr address)
+{
+    unsigned char   *wire = frame->wire;
+    unsigned char   *headersum = wire + frame->payloadat - cksum->bytes;
+    unsigned char   *hops = wire + frame->payloadat + frame->len;
+    size_t          trailer = frame->len > 0 ? cksum->bytes : 0;
+    unsigned char   *p = wire + frame->wirelen - trailer;
+    unsigned char   payloadsum[MAX_CHECKSUM];
+
+    memcpy(payloadsum, p, trailer);
+    p = put_varint(p, ZIGZAG(address));
+    memcpy(p, payloadsum, trailer);
+    headersum[-1] = frame->lenhops;         // lenhops is the last field of the header
+    frame->checksum = cksum->fn(cksum->fn(0, wire, headersum - wire), hops, p - hops);
+    put_sum(headersum, frame->checksum);
+    frame->wirelen = p + trailer - wire;
+}
+
+
+//  HOW LONG TO WAIT FOR THE ACK OF A FRAME CARRYING length BYTES SENT ON link
+CnetTime retransmit_timeout(int link, size_t length)
+{
+    CnetTime	timeout;
+    timeout     = (MAX_WIRE_HEADER + length)*((CnetTime)8000000 / linkinfo[link].bandwidth) + linkinfo[link].propagationdelay;
+    return 10*timeout;
+}
+
+//  BOUNDS ON THE ADAPTIVE RETRANSMISSION TIMEOUT. BACKING OFF NEVER TAKES THE TIMEOUT PAST MAX_BACKOFF_SRTT TIMES
+//  THE SMOOTHED RTT, OR THE UNBACKED TIMEOUT IF THAT IS LONGER, AND BEFORE THE FIRST SAMPLE NEVER PAST
+//  MAX_BACKOFF_SRTT TIMES THE INITIAL GUESS, WHICH STANDS IN FOR THE RTT UNTIL THEN
+#define MIN_RTO             ((CnetTime)200000)
+#define MAX_BACKOFF         64
+#define MAX_BACKOFF_SRTT    2
+
+//  THE RETRANSMISSION TIMEOUT OF A CONNECTION, FROM ITS RTT ESTIMATE ONCE IT HAS ONE
+CnetTime conn_rto(int connection, int link, size_t length)
+{
+    CONN        *c = &conn[connection];
+    CnetTime    rto, cap;
+
+    if(c->rttsamples == 0)
+    {
+        rto = retransmit_timeout(link, length);
+        cap = MAX_BACKOFF_SRTT*rto;
+    }
+    else
+    {
+        rto = c->srtt + 4*c->rttvar;
+        if(rto < MIN_RTO)
+            rto = MIN_RTO;
+        cap = MAX_BACKOFF_SRTT*c->srtt;
+    }
+    if(cap < rto)
+        cap = rto;
+    rto *= c->backoff;
+    return rto > cap ? cap : rto;
+}
+
+//  FOLD A NEW ROUND-TRIP MEASUREMENT INTO THE ESTIMATE OF A CONNECTION
+void rtt_sample(int connection, CnetTime rtt)
+{
+    CONN    *c = &conn[connection];
+
+    if(c->rttsamples == 0)
+    {
+        c->srtt     = rtt;
+        c->rttvar   = rtt / 2;
+        c->minrtt   = rtt;
+        c->maxrtt   = rtt;
+    }
+    else
+    {
+        CnetTime err = c->srtt > rtt ? c->srtt - rtt : rtt - c->srtt;
+
+        c->rttvar   = (3*c->rttvar + err) / 4;
+        c->srtt     = (7*c->srtt + rtt) / 8;
+        if(rtt < c->minrtt)
+            c->minrtt = rtt;
+        if(rtt > c->maxrtt)
+            c->maxrtt = rtt;
+    }
+    int bucket = 0;
+    for(CnetTime msec = rtt / 1000; msec > 0 && bucket < RTT_BUCKETS - 1; msec >>= 1)
+        bucket++;
+    c->rtthist[bucket]++;
+    c->rttsamples++;
+}
+
+//  TIMERS CARRY THEIR CONNECTION (AND SELECTIVE REPEAT SLOT) AS THEIR CnetData
+#define TIMER_DATA(connection, slot)	((CnetData)(connection)*MAX_WINDOW + (slot))
+
+//  THE NEXT TRANSMISSION NUMBER STAMPED ON A FRAME THIS NODE SENDS
+unsigned short  nextxmit = 0;
+
+//  THE HOP LIST IS ONLY THE LOOP GUARD WHEN THE DUPLICATE CACHE IS OFF, OTHERWISE IT IS NOT WORTH ITS BYTES
+//  A RECEIVED FRAME IS PATCHED WHERE IT LIES, UNLESS IT HAS NO HOP COUNT IN ITS HEADER TO BUMP, WHEN ITS PAYLOAD
+//  IS COPIED OUT FOR IT TO BE ENCODED AFRESH
+void add_hop(FRAME *frame)
+{
+    if(dupcache || frame->lenhops == MAX_HOPS)
+        return;
+    frame->hops[frame->lenhops++] = nodeinfo.address;
+    if(frame->wire == NULL)
+        return;
+    if(frame->wire[0] & WIRE_HOPS)
+        patch_hop(frame, nodeinfo.address);
+    else
+    {
+        memcpy(&frame->msg, frame_payload(frame), frame->len);
+        payloadcopies += frame->len > 0;
+        frame->wire = NULL;
+    }
+}
+
+//  FILL IN THE HEADER AND PAYLOAD OF A FRAME, A DATA FRAME MAY CARRY AN ACK AS WELL
+void build_frame(FRAME *frame, FRAMEKIND kind, CnetAddr source, CnetAddr destination, MSG *msg, size_t length, int seqno, int ack, bool hop, CnetAddr hops[7], int lenhops, int xmit)
+{
+    //  INITIALISE THE FRAME'S HEADER FIELDS
+    frame->kind          = kind;
+    frame->source        = source;
+    frame->destination   = destination;
+    frame->seq           = seqno;
+    frame->ack           = ack;
+    frame->len           = length;
+    frame->batched       = false;
+    frame->parity        = false;
+    frame->xmit          = xmit == -1 ? nextxmit++ : xmit;
+    frame->checksum      = 0;
+    frame->payloadsummed = false;
+    frame->wire          = NULL;
+    memcpy(frame->hops, hops, sizeof(CnetAddr)*MAX_HOPS);
+    frame->lenhops       = lenhops;
+    if(hop)
+        add_hop(frame);
+
+    if(msg != NULL)
+    {
+    	memcpy(&frame->msg, msg, length);
+        payloadcopies++;
+    }
+}
+
+//  CREATE THIS NODE'S TRACE FILE AND WRITE ITS HEADER, TRACING STAYS OFF IF THE FILE CANNOT BE CREATED
+void trace_open()
+{
+    char        name[128];
+    TRACEHEADER header;
+
+    snprintf(name, sizeof(name), "%s.%s.trc", tracefile, nodeinfo.nodename);
+    if((tracefp = fopen(name, "wb")) == NULL)
+    {
+        LOG(LOG_ERROR, "cannot create trace file %s\n", name);
+        return;
+    }
+    memset(&header, 0, sizeof(header));
+    header.magic        = TRACE_MAGIC;
+    header.version      = TRACE_VERSION;
+    header.recordsize   = sizeof(TRACEREC);
+    header.address      = nodeinfo.address;
+    snprintf(header.nodename, sizeof(header.nodename), "%.31s", nodeinfo.nodename);
+    fwrite(&header, sizeof(header), 1, tracefp);
+
+    tracebuf    = malloc(tracesize * sizeof(TRACEREC));
+    tracenext   = 0;
+}
+
+//  APPEND WHAT THE BUFFER HOLDS TO THE TRACE FILE AND START FILLING IT FROM THE BEGINNING AGAIN
+void trace_flush()
+{
+    if(tracebuf == NULL)
+        return;
+    fwrite(tracebuf, sizeof(TRACEREC), tracenext, tracefp);
+    fflush(tracefp);
+    tracenext = 0;
+}
+
+void trace_record(TRACEEVENT event, FRAMEKIND kind, CnetAddr source, CnetAddr destination, int seq, int ack, int link, size_t length, int xmit)
+{
+    TRACEREC    *r = &tracebuf[tracenext];
+
+    r->time         = nodeinfo.time_in_usec;
+    r->node         = nodeinfo.address;
+    r->source       = source;
+    r->destination  = destination;
+    r->length       = length;
+    r->xmit         = xmit;
+    r->link         = link;
+    r->event        = event;
+    r->kind         = kind;
+    r->seq          = seq;
+    r->ack          = ack;
+    if(++tracenext == tracesize)
+        trace_flush();
+}
+
+//  WITH TRACING OFF AN EVENT COSTS ONE TEST
+#define TRACE(event, kind, source, destination, seq, ack, link, length, xmit) \
+    do { if(tracebuf != NULL) trace_record(event, kind, source, destination, seq, ack, link, length, xmit); } while(0)
+#define TRACE_FRAME(event, frame, link, length) \
+    TRACE(event, (frame)->kind, (frame)->source, (frame)->destination, (frame)->seq, (frame)->ack, link, length, (frame)->xmit)
+
+void initialize_queues()
+{
+    linkqueues = calloc(nodeinfo.nlinks + 1, sizeof(LINKQUEUE));
+    for(int i = 0; i <= nodeinfo.nlinks; i++)
+    {
+        LINKQUEUE *q = &linkqueues[i];
+
+        q->maxflow      = 8;
+        q->flows        = malloc(q->maxflow * sizeof(FLOW));
+        hash_init(&q->flowindex, 2*q->maxflow);
+        q->firstactive  = q->lastactive = -1;
+    }
+}
+
+//  HOW LONG length BYTES TAKE TO TRANSMIT ON link
+CnetTime transmit_time(int link, size_t length)
+{
+    return linkinfo[link].bandwidth > 0 ? (CnetTime)length * 8 * 1000000 / linkinfo[link].bandwidth : 0;
+}
+
+//  THE COUNTERS OF WHAT A FRAME WAS SENT FOR, NULL IF NOTHING
+STATS *owner_stats(OWNER owner)
+{
+    switch(owner.kind)
+    {
+        case OWNER_CONN:    return &conn[owner.index].stats;
+        case OWNER_ROUTE:   return &routes[owner.index].stats;
+        case OWNER_DVROUTE: return &dvroutes[owner.index].stats;
+        default:            return NULL;
+    }
+}
+
+//  WRITE length BYTES OF wire TO link AT ONCE, RETURNING FALSE IF THE LINK TURNED OUT TO BE STILL BUSY.
+//  ONLY A FRAME THE PHYSICAL LAYER TOOK KEEPS THE LINK BUSY AND IS COUNTED AS SENT, ON IT AND FOR ITS owner
+bool link_write(int link, unsigned char *wire, size_t length, OWNER owner)
+{
+    LINKQUEUE   *q = &linkqueues[link];
+    CnetTime    xmit = transmit_time(link, length);
+
+    if(CNET_write_physical(link, wire, &length) == 0)
+    {
+        q->busyuntil = nodeinfo.time_in_usec + xmit;
+        q->busytime += xmit;
+        linkstats[link].framessent++;
+        linkstats[link].bytessent += length;
+        STATS *stats = owner_stats(owner);
+        if(stats != NULL)
+        {
+            stats->framessent++;
+            stats->bytessent += length;
+        }
+        return true;
+    }
+    if(cnet_errno != ER_TOOBUSY)
+        CNET_exit(__FILE__, __func__, __LINE__);
+    q->retryat = nodeinfo.time_in_usec + xmit;
+    return false;
+}
+
+//  WHEN link MAY NEXT BE WRITTEN
+CnetTime link_free(LINKQUEUE *q)
+{
+    return q->busyuntil > q->retryat ? q->busyuntil : q->retryat;
+}
+
+//  START THE PACING TIMER OF link, TO GO OFF WHEN IT IS FREE
+void link_pace(int link)
+{
+    LINKQUEUE   *q = &linkqueues[link];
+    CnetTime    until = link_free(q);
+
+    q->pacer = CNET_start_timer(EV_TIMER4, until > nodeinfo.time_in_usec ? until - nodeinfo.time_in_usec : 1, link);
+}
+
+int find_flow(LINKQUEUE *q, CnetAddr source, CnetAddr destination)
+{
+    int f = hash_find(&q->flowindex, ROUTE_KEY(source, destination));
+
+    if(f != -1)
+        return f;
+    if(q->numflow == q->maxflow)
+    {
+        q->maxflow *= 2;
+        q->flows = realloc(q->flows, q->maxflow * sizeof(FLOW));
+    }
+    f = q->numflow++;
+    memset(&q->flows[f], 0, sizeof(FLOW));
+    q->flows[f].source      = source;
+    q->flows[f].destination = destination;
+    q->flows[f].nextactive  = -1;
+    hash_insert(&q->flowindex, ROUTE_KEY(source, destination), f);
+    return f;
+}
+
+//  TAKE THE OLDEST FRAME OF A FLOW OFF ITS QUEUE, AND THE FLOW OUT OF THE ROUND ONCE IT HAS NONE LEFT
+QFRAME *flow_pop(LINKQUEUE *q, int f, int prev)
+{
+    FLOW    *flow = &q->flows[f];
+    QFRAME  *qf = flow->head;
+
+    flow->head = qf->next;
+    flow->queued--;
+    q->queued--;
+    if(flow->head == NULL)
+    {
+        flow->tail      = NULL;
+        flow->deficit   = 0;
+        flow->inturn    = false;
+        if(prev == -1)
+            q->firstactive = flow->nextactive;
+        else
+            q->flows[prev].nextactive = flow->nextactive;
+        if(q->lastactive == f)
+            q->lastactive = prev;
+        flow->nextactive = -1;
+    }
+    return qf;
+}
+
+//  WHEN THE LINK IS FULL, THE LONGEST FLOW DROPS ITS OLDEST FRAME, SO THAT A HEAVY SENDER CANNOT CROWD OUT THE REST
+void queue_drop(LINKQUEUE *q)
+{
+    int longest = q->firstactive, longestprev = -1;
+
+    for(int prev = q->firstactive, f = q->flows[prev].nextactive; f != -1; prev = f, f = q->flows[f].nextactive)
+    {
+        if(q->flows[f].queued > q->flows[longest].queued)
+        {
+            longest     = f;
+            longestprev = prev;
+        }
+    }
+    LOG(LOG_WARN, "QUEUE full, frame dropped: (src= %i, dest= %i)\n", q->flows[longest].source, q->flows[longest].destination);
+    q->flows[longest].drops++;
+    q->drops++;
+    free(flow_pop(q, longest, longestprev));
+}
+
+//  QUEUE A COPY OF length BYTES OF wire ON ITS FLOW, JOINING THE ROUND IF THE FLOW HAD NOTHING QUEUED
+void enqueue(LINKQUEUE *q, FRAME *frame, unsigned char *wire, size_t length, OWNER owner)
+{
+    if(q->queued >= queuelimit)
+        queue_drop(q);
+
+    int     f = find_flow(q, frame->source, frame->destination);
+    FLOW    *flow = &q->flows[f];
+    QFRAME  *qf = malloc(sizeof(QFRAME) + length);
+
+    qf->next    = NULL;
+    qf->owner   = owner;
+    qf->length  = length;
+    memcpy(qf->wire, wire, length);
+    payloadcopies += frame->len > 0;
+    if(flow->head == NULL)
+    {
+        flow->head = qf;
+        if(q->lastactive == -1)
+            q->firstactive = f;
+        else
+            q->flows[q->lastactive].nextactive = f;
+        q->lastactive = f;
+    }
+    else
+        flow->tail->next = qf;
+    flow->tail = qf;
+    flow->queued++;
+    q->enqueued++;
+    if(++q->queued > q->peak)
+        q->peak = q->queued;
+}
+
+//  DEFICIT ROUND-ROBIN: THE FLOW AT THE HEAD OF THE ROUND GETS quantum MORE BYTES AS ITS TURN BEGINS, AND SENDS
+//  WHILE ITS OLDEST FRAME FITS IN WHAT IT HAS, THEN GOES TO THE BACK. RETURNS THE FLOW TO SEND FROM NEXT
+int drr_next(LINKQUEUE *q)
+{
+    for(;;)
+    {
+        int     f = q->firstactive;
+        FLOW    *flow = &q->flows[f];
+
+        if(!flow->inturn)
+        {
+            flow->deficit   += quantum;
+            flow->inturn    = true;
+        }
+        if(flow->deficit >= flow->head->length)
+            return f;
+        flow->inturn = false;
+        if(flow->nextactive != -1)
+        {
+            q->firstactive                      = flow->nextactive;
+            q->flows[q->lastactive].nextactive  = f;
+            q->lastactive                       = f;
+            flow->nextactive                    = -1;
+        }
+    }
+}
+
+//  THE PACING TIMER OF A LINK: ITS LAST FRAME HAS BEEN TRANSMITTED, SO SEND THE NEXT ONE QUEUED
+EVENT_HANDLER(link_ready)
+{
+    LINKQUEUE   *q = &linkqueues[data];
+
+    q->pacer = NULLTIMER;
+    if(q->queued > 0 && link_free(q) <= nodeinfo.time_in_usec)
+    {
+        int     f = drr_next(q);
+        QFRAME  *qf = q->flows[f].head;
+
+        if(link_write(data, qf->wire, qf->length, qf->owner))
+        {
+            q->flows[f].deficit -= qf->length;
+            free(flow_pop(q, f, -1));
+        }
+    }
+    if(q->queued > 0)
+        link_pace(data);
+}
+
+//  WRITE THE ENCODED frame TO link FOR owner, OR QUEUE IT WHILE THE LINK IS BUSY, RETURNING ITS LENGTH ON THE WIRE
+size_t write_wire(int link, FRAME *frame, unsigned char *wire, size_t length, OWNER owner)
+{
+    LINKQUEUE *q = &linkqueues[link];
+
+    wireheaderbytes     += length - frame->len;
+    structheaderbytes   += STRUCT_HEADER_SIZE;
+    if(q->queued == 0 && link_free(q) <= nodeinfo.time_in_usec && link_write(link, wire, length, owner))
+        return length;
+    enqueue(q, frame, wire, length, owner);
+    if(q->pacer == NULLTIMER)
+        link_pace(link);
+    return length;
+}
+
+//  ENCODE AN ALREADY BUILT FRAME AND WRITE IT TO THE PHYSICAL LAYER FOR owner, RETURNING ITS LENGTH ON THE WIRE
+size_t write_frame(int link, FRAME *frame, OWNER owner)
+{
+    unsigned char   wire[MAX_WIRE_SIZE];
+
+    return write_wire(link, frame, wire, frame_encode(frame, wire), owner);
+}
+
+//  READ THE NEXT FRAME FROM THE PHYSICAL LAYER INTO wire, OF MAX_WIRE_SIZE BYTES, AND SAY WHETHER IT ARRIVED
+//  CORRUPTED. THE FRAME'S PAYLOAD STAYS IN wire
+WIRESTATUS read_frame(int *link, unsigned char *wire, FRAME *frame, size_t *length)
+{
+    WIRESTATUS      status;
+
+    *length = MAX_WIRE_SIZE;
+    CHECK(CNET_read_physical(link, wire, length));
+    linkstats[*link].framesreceived++;
+    linkstats[*link].bytesreceived += *length;
+    linkheard[*link] = nodeinfo.time_in_usec;
+    if((status = frame_decode(wire, *length, frame)) != WIRE_OK)
+        linkstats[*link].badchecksums++;
+    if(status == WIRE_BADHEADER)
+    {
+        LOG(LOG_WARN, "BAD frame received: (length= %li, from link= %i)\n", *length, *link);
+        TRACE(TR_BADHEADER, 0, -1, -1, -1, -1, *link, *length, 0);
+    }
+    else if(status == WIRE_BADPAYLOAD)
+    {
+        LOG(LOG_WARN, "BAD payload received: (src= %i, dest= %i, seq= %i, length= %li, from link= %i)\n", frame->source, frame->destination, frame->seq, *length, *link);
+        TRACE_FRAME(TR_BADPAYLOAD, frame, *link, *length);
+    }
+    return status;
+}
+
+//  A FUNCTION TO TRANSMIT EITHER A DATA OR AN ACKNOWLEDGMENT FRAME, TRACED AS event, RETURNING ITS LENGTH ON THE WIRE
+size_t transmit_frame(TRACEEVENT event, FRAMEKIND kind, CnetAddr source, CnetAddr destination, MSG *msg, size_t length, int seqno, int ack, int link, bool hop, CnetAddr hops[7], int lenhops, int xmit)
+{
+    FRAME   frame;
+
+    build_frame(&frame, kind, source, destination, msg, length, seqno, ack, hop, hops, lenhops, xmit);
+
+//  FINALLY, WRITE THE FRAME TO THE PHYSICAL LAYER
+    size_t wirelength = write_frame(link, &frame, NO_OWNER);
+    TRACE_FRAME(event, &frame, link, wirelength);
+    return wirelength;
+}
+
+//  RETURN TRUE IF a <= b < c CIRCULARLY, AS SEQNOS WRAP AROUND AT maxseq
+bool between(int a, int b, int c)
+{
+    return ((a <= b) && (b < c)) || ((c < a) && (a <= b)) || ((b < c) && (c < a));
+}
+
+//  FIND THE CONNECTION TO destaddr, OPENING A NEW ONE IF NO FRAME HAS BEEN EXCHANGED WITH IT YET
+int open_conn(CnetAddr destaddr)
+{
+    int connection = check_conn(destaddr);
+    if(connection != -1)
+        return connection;
+
+//  THE TABLE MAY MOVE WHEN IT GROWS, SO NOBODY HOLDS A CONN POINTER ACROSS A CALL TO open_conn
+    if(numconn == maxconn)
+    {
+        maxconn *= 2;
+        conn    = realloc(conn, maxconn * sizeof(CONN));
+    }
+    connection = numconn++;
+    hash_insert(&connindex, (uint32_t)destaddr, connection);
+
+    CONN *c = &conn[connection];
+    c->destaddress   = destaddr;
+    c->lasttimer     = NULLTIMER;
+    c->nextframe     = 0;
+    c->ackexpected   = 0;
+    c->frameexpected = 0;
+    c->ackearned     = false;
+    c->dataxmit      = -1;
+    c->ackxmit       = -1;
+    c->srtt          = 0;
+    c->rttvar        = 0;
+    c->backoff       = 1;
+    c->rttsamples    = 0;
+    c->minrtt        = 0;
+    c->maxrtt        = 0;
+    c->queuehead     = 0;
+    c->queued        = 0;
+    c->throttled     = false;
+    c->nbuffered     = 0;
+    c->sendframe     = malloc(windowsize * sizeof(FRAME));
+    c->toofar        = windowsize;
+    c->recvbuf       = arqmode == ARQ_SELECTIVEREPEAT ? malloc(windowsize * sizeof(MSG)) : NULL;
+    c->ackpending    = false;
+    c->acktimer      = NULLTIMER;
+    c->acklink       = 0;
+    c->fecnext       = 0;
+    c->fecexpected   = 0;
+    c->fecn          = 0;
+    c->fectimer      = NULLTIMER;
+    c->feck          = fecblock;
+    c->fecm          = fecparity;
+    c->fecloss       = 0;
+    c->fecadapted    = 0;
+    c->fecstore      = fec != FEC_NONE ? malloc(2*windowsize * sizeof(MSG)) : NULL;
+    c->fecparitybuf  = fec != FEC_NONE ? malloc(FEC_MAX_PARITY * sizeof(MSG)) : NULL;
+    c->fecnparity    = 0;
+    memset(c->fecsum, 0, sizeof(c->fecsum));
+    memset(c->rtthist, 0, sizeof(c->rtthist));
+    memset(&c->stats, 0, sizeof(STATS));
+    for(int j = 0; j < MAX_WINDOW; j++)
+    {
+        c->acked[j]     = false;
+        c->sendtimer[j] = NULLTIMER;
+        c->arrived[j]   = false;
+    }
+    return connection;
+}
+
+//  REMEMBER THAT source AND destination TALK TO EACH OTHER THROUGH link
+void learn_route(CnetAddr source, CnetAddr destination, int link)
+{
+    if(check_route(source, destination) == -1)
+        add_route(source, destination, link, link);
+    if(check_route(destination, source) == -1)
+        add_route(destination, source, link, link);
+}
+
+//  THE PAYLOAD OF A BATCH OF THE FIRST n MESSAGES QUEUED ON A CONNECTION, EACH AFTER ITS VARINT LENGTH
+size_t batch_size(CONN *c, int n)
+{
+    size_t size = 0;
+
+    for(int i = 0; i < n; i++)
+    {
+        size_t len = c->queuelen[(c->queuehead + i) % MAX_QUEUE];
+
+        size += len + (len < 0x80 ? 1 : len < 0x4000 ? 2 : 3);
+    }
+    return size;
+}
+
+//  FILL SLOT slot OF A CONNECTION WITH ONE FRAME CARRYING AS MANY OF ITS QUEUED MESSAGES AS FIT
+void build_batch(CONN *c, int slot)
+{
+    FRAME       *frame = &c->sendframe[slot];
+    CnetAddr    hops[7] = {-1,-1,-1,-1,-1,-1,-1};
+    int         n = 2;
+
+    while(n < c->queued && batch_size(c, n + 1) <= sizeof(MSG))
+        n++;
+    build_frame(frame, DL_DATA, nodeinfo.address, c->destaddress, NULL, 0, c->nextframe, -1, true, hops, 0, -1);
+
+    unsigned char *p = (unsigned char *)&frame->msg;
+    c->queuedat[slot] = 0;
+    for(int i = 0; i < n; i++)
+    {
+        p = put_varint(p, c->queuelen[c->queuehead]);
+        memcpy(p, c->queue[c->queuehead], c->queuelen[c->queuehead]);
+        p += c->queuelen[c->queuehead];
+        free(c->queue[c->queuehead]);
+        c->queuedat[slot] += c->queuetime[c->queuehead];
+        c->queuehead = (c->queuehead + 1) % MAX_QUEUE;
+    }
+    payloadcopies += n;
+    frame->len      = p - (unsigned char *)&frame->msg;
+    frame->batched  = true;
+    c->nmsgs[slot]  = n;
+    c->queued      -= n;
+    batchframes++;
+    batchmsgs      += n;
+}
+
+//  (RE)TRANSMIT THE BUFFERED FRAME seqno OF A CONNECTION AND START ITS TIMER
+void window_transmit(int connection, int seqno)
+{
+    CONN        *c = &conn[connection];
+    int         slot = seqno % windowsize;
+    FRAME       *frame = &c->sendframe[slot];
+    int         link = next_link(c->destaddress);
+    TRACEEVENT  event = c->retransmitted[slot] ? TR_RESENT : TR_SENT;
+    size_t      length;
+
+//  THE FRAME WAS BUILT ONCE, A RETRANSMISSION ONLY RESTAMPS IT SO THAT RELAYS DO NOT TAKE IT FOR A DUPLICATE
+    if(c->retransmitted[slot])
+        frame->xmit = nextxmit++;
+
+//  AN ACK OWED TO THE PEER RIDES ON THIS FRAME INSTEAD OF TRAVELLING ON ITS OWN
+    c->xmittime[slot] = nodeinfo.time_in_usec;
+    frame->ack = -1;
+    if(c->ackpending)
+    {
+        frame->ack      = CUMULATIVE_ACK(c);
+        c->ackpending   = false;
+        CNET_stop_timer(c->acktimer);
+        c->acktimer     = NULLTIMER;
+        piggybacked++;
+    }
+    if(link == -1)
+    {
+        LOG(LOG_TRACE, "Link unknown, transmitting to every node\n");
+        for(int i = 1; i <= nodeinfo.nlinks; i++)
+        {
+            LOG(LOG_TRACE, "DATA transmitted: (src= %i, dest= %i, seq= %i, ack= %i, msgLen= %li, to link: %i)\n", nodeinfo.address, c->destaddress, seqno, frame->ack, frame->len, i);
+            length = write_frame(i, frame, CONN_OWNER(connection));
+            TRACE_FRAME(event, frame, i, length);
+            c->stats.flooded++;
+        }
+        link = nodeinfo.nlinks;
+    }
+    else
+    {
+        LOG(LOG_TRACE, "DATA transmitted: (src= %i, dest= %i, seq= %i, ack= %i, msgLen= %li, to link: %i)\n", nodeinfo.address, c->destaddress, seqno, frame->ack, frame->len, link);
+        length = write_frame(link, frame, CONN_OWNER(connection));
+        TRACE_FRAME(event, frame, link, length);
+    }
+
+//  GO-BACK-N TIMES ONLY THE OLDEST FRAME, SELECTIVE REPEAT TIMES EVERY SLOT
+    if(arqmode != ARQ_SELECTIVEREPEAT)
+    {
+        if(c->lasttimer == NULLTIMER)
+            c->lasttimer = CNET_start_timer(EV_TIMER1, conn_rto(connection, link, frame->len), TIMER_DATA(connection, 0));
+    }
+    else
+    {
+        if(c->sendtimer[slot] != NULLTIMER)
+            CNET_stop_timer(c->sendtimer[slot]);
+        c->sendtimer[slot] = CNET_start_timer(EV_TIMER1, conn_rto(connection, link, frame->len), TIMER_DATA(connection, slot));
+    }
+}
+
+//  FEC: ONE PARITY FRAME MORE PER BLOCK WHILE MORE THAN fectarget PERCENT OF FRAMES STILL TIME OUT, ONE FEWER
+//  ONCE UNDER A QUARTER OF THAT DO, AT MOST ONCE A ROUND TRIP. XOR HAS ONLY ONE, SO ITS BLOCKS SHRINK INSTEAD
+void fec_adapt(CONN *c)
+{
+    if(nodeinfo.time_in_usec - c->fecadapted < c->srtt)
+        return;
+    if(c->fecloss > 10*fectarget)
+    {
+        if(fec == FEC_RS && c->fecm < FEC_MAX_PARITY)
+            c->fecm++;
+        else if(fec == FEC_XOR && c->feck > 1)
+            c->feck--;
+        else
+            return;
+    }
+    else if(c->fecloss < 10*fectarget/4)
+    {
+        if(fec == FEC_RS && c->fecm > 1)
+            c->fecm--;
+        else if(fec == FEC_XOR && c->feck < fecblock)
+            c->feck++;
+        else
+            return;
+    }
+    else
+        return;
+    c->fecadapted = nodeinfo.time_in_usec;
+    LOG(LOG_INFO, "FEC adapted: (dest= %i, loss= %i/1000, block= %i, parity= %i)\n", c->destaddress, c->fecloss, c->feck, c->fecm);
+}
+
+//  FEC: SEND THE PARITY OF THE BLOCK OF DATA FRAMES JUST SENT ON A CONNECTION. A PARITY FRAME'S PAYLOAD IS THE
+//  BLOCK'S UNWRAPPED FIRST SEQNO, ITS NUMBER OF FRAMES, THE PARITY ROW AND THE CHECKSUM OF EVERY FRAME IN THE BLOCK,
+//  FEC_HEADER BYTES IN ALL, THEN THE PARITY OF THE FRAMES' SYMBOLS. THE CHECKSUMS LET THE RECEIVER TELL THE
+//  FRAMES OF THIS BLOCK FROM OLDER ONES WITH THE SAME SEQNOS, AND CHECK WHAT IT REBUILDS
+void fec_flush(int connection)
+{
+    CONN            *c = &conn[connection];
+    int             link = next_link(c->destaddress);
+    int             n = c->fecn;
+    unsigned char   prefix[FEC_MAX_DATA][FEC_PREFIX];
+    unsigned char   *prefixes[FEC_MAX_DATA];
+    unsigned char   *payloads[FEC_MAX_DATA];
+    size_t          prefixlen[FEC_MAX_DATA];
+    size_t          lengths[FEC_MAX_DATA];
+    size_t          longest = 0;
+    CnetAddr        hops[7] = {-1,-1,-1,-1,-1,-1,-1};
+    FRAME           parity;
+
+    if(c->fectimer != NULLTIMER)
+        CNET_stop_timer(c->fectimer);
+    c->fectimer = NULLTIMER;
+    c->fecn     = 0;
+    if(n == 0)
+        return;
+
+    build_frame(&parity, DL_DATA, nodeinfo.address, c->destaddress, NULL, 0, -1, -1, true, hops, 0, -1);
+    unsigned char *p = (unsigned char *)&parity.msg;
+    for(int b = 0; b < 4; b++)
+        p[b] = c->fecfirst >> (8*b);
+    p[4] = n;
+    for(int i = 0, seqno = c->fecfirst % (maxseq + 1); i < n; i++, increment(seqno))
+    {
+        FRAME *frame = &c->sendframe[seqno % windowsize];
+
+        if(!frame->payloadsummed)
+        {
+            frame->payloadsum       = cksum->fn(0, (unsigned char *)&frame->msg, frame->len);
+            frame->payloadsummed    = true;
+        }
+        for(int b = 0; b < 4; b++)
+            p[6 + 4*i + b] = frame->payloadsum >> (8*b);
+        prefix[i][0]    = frame->len & 0xff;
+        prefix[i][1]    = frame->len >> 8;
+        prefix[i][2]    = frame->batched;
+        prefixes[i]     = prefix[i];
+        prefixlen[i]    = FEC_PREFIX;
+        payloads[i]     = (unsigned char *)&frame->msg;
+        lengths[i]      = frame->len;
+        if(frame->len > longest)
+            longest = frame->len;
+    }
+    parity.len      = FEC_HEADER(n) + FEC_PREFIX + longest;
+    parity.parity   = true;
+
+    unsigned char *symbol = p + FEC_HEADER(n);
+    for(int row = 0; row < c->fecm; row++)
+    {
+        p[5] = row;
+        fec_encode(fec, row, prefixes, prefixlen, n, symbol, FEC_PREFIX);
+        fec_encode(fec, row, payloads, lengths, n, symbol + FEC_PREFIX, longest);
+        if(row > 0)
+        {
+            parity.xmit             = nextxmit++;
+            parity.payloadsummed    = false;
+        }
+
+//  LIKE THE DATA FRAMES, PARITY GOES TO EVERY LINK WHILE THE WAY TO ITS DESTINATION IS UNKNOWN
+        for(int i = link == -1 ? 1 : link; i <= (link == -1 ? nodeinfo.nlinks : link); i++)
+        {
+            LOG(LOG_TRACE, "PARITY transmitted: (src= %i, dest= %i, first= %i, frames= %i, row= %i, to link: %i)\n", nodeinfo.address, c->destaddress, (int)(c->fecfirst % (maxseq + 1)), n, row, i);
+            size_t length = write_frame(i, &parity, CONN_OWNER(connection));
+            TRACE_FRAME(TR_SENT, &parity, i, length);
+            c->stats.flooded += link == -1;
+        }
+        fecsent++;
+    }
+
+//  A FRAME OF THE BLOCK THAT IS LOST NOW WAITS FOR THE PARITY TO BE REBUILT BEFORE IT IS RESENT
+    for(int i = 0, seqno = c->fecfirst % (maxseq + 1); i < n; i++, increment(seqno))
+    {
+        int slot = seqno % windowsize;
+
+        if(c->sendtimer[slot] != NULLTIMER)
+        {
+            CNET_stop_timer(c->sendtimer[slot]);
+            c->sendtimer[slot] = CNET_start_timer(EV_TIMER1, conn_rto(connection, link == -1 ? nodeinfo.nlinks : link, parity.len), TIMER_DATA(connection, slot));
+        }
+    }
+    fec_adapt(c);
+}
+
+//  FEC: A FRAME SENT FOR THE FIRST TIME JOINS THE BLOCK BEING SENT, WHOSE PARITY FOLLOWS ONCE IT IS FULL.
+//  A FRAME LEAVING NO ROOM FOR THE PARITY HEADER GOES UNPROTECTED
+void fec_add(int connection, int seqno)
+{
+    CONN *c = &conn[connection];
+
+    c->fecloss -= (c->fecloss + 15) / 16;
+    if(c->sendframe[seqno % windowsize].len > FEC_MAX_LEN)
+    {
+        fec_flush(connection);
+        return;
+    }
+    if(c->fecn++ == 0)
+    {
+        c->fecfirst = c->fecnext;
+        c->fectimer = CNET_start_timer(EV_TIMER5, fecdelay, connection);
+    }
+    if(c->fecn == c->feck)
+        fec_flush(connection);
+}
+
+//  MOVE QUEUED MESSAGES INTO THE SEND WINDOW OF A CONNECTION WHILE IT HAS ROOM, AND TRANSMIT THEM
+void window_send(int connection)
+{
+    CONN        *c = &conn[connection];
+    CnetAddr    hops[7] = {-1,-1,-1,-1,-1,-1,-1};
+
+    while(c->nbuffered < windowsize && c->queued > 0)
+    {
+        int     slot = c->nextframe % windowsize;
+        FRAME   *frame = &c->sendframe[slot];
+
+        if(aggregate && c->queued > 1 && batch_size(c, 2) <= sizeof(MSG))
+            build_batch(c, slot);
+        else
+        {
+            build_frame(frame, DL_DATA, nodeinfo.address, c->destaddress, c->queue[c->queuehead], c->queuelen[c->queuehead], c->nextframe, -1, true, hops, 0, -1);
+            free(c->queue[c->queuehead]);
+            c->queuedat[slot] = c->queuetime[c->queuehead];
+            c->nmsgs[slot]    = 1;
+            c->queuehead      = (c->queuehead + 1) % MAX_QUEUE;
+            c->queued--;
+        }
+        c->acked[slot]   = false;
+        c->sendtime[slot] = nodeinfo.time_in_usec;
+        c->retransmitted[slot] = false;
+        c->nbuffered++;
+        window_transmit(connection, c->nextframe);
+        if(fec != FEC_NONE)
+            fec_add(connection, c->nextframe);
+        increment(c->nextframe);
+        c->fecnext++;
+    }
+
+//  A FULL WINDOW CANNOT ADD TO THE BLOCK BEFORE THE NEXT ACK, SO ITS PARITY GOES NOW
+    if(c->fecn > 0 && c->nbuffered == windowsize)
+        fec_flush(connection);
 
-//  THE LAST FIELD IN THE FRAME IS THE PAYLOAD, OUR MESSAGE
-    MSG          msg;
-} FRAME;
+//  ONLY THIS DESTINATION WAS THROTTLED, SO ONLY THIS DESTINATION IS RELEASED
+    if(c->throttled && c->queued < MAX_QUEUE)
+    {
+        CNET_enable_application(c->destaddress);
+        c->throttled = false;
+    }
+}
 
-typedef struct {
-    CnetAddr    source;
-    CnetAddr    destination;
-    int         incoming_link;
-    int         outgoing_link;
-} ROUTES;
+//  THE LOWER EDGE OF THE SEND WINDOW HAS BEEN ACKNOWLEDGED, SLIDE PAST IT
+void window_retire(CONN *c)
+{
+    int slot = c->ackexpected % windowsize;
 
-ROUTES routes[42];
-int numroute = 0; 
+    TRACE(TR_ACKED, DL_DATA, nodeinfo.address, c->destaddress, c->ackexpected, -1, 0, 0, c->sendframe[slot].xmit);
+    latencysum += c->nmsgs[slot] * nodeinfo.time_in_usec - c->queuedat[slot];
+    latencies  += c->nmsgs[slot];
+    c->acked[slot] = false;
+    c->nbuffered--;
+    increment(c->ackexpected);
+//  THE PEER IS GETTING FRAMES THROUGH, SO ANY EXPONENTIAL BACKOFF ENDS (RFC 6298 5.7), SAMPLE OR NOT
+    c->backoff = 1;
+}
 
-//  THE FORMAT OF A CONNECTION
-typedef struct {
-    CnetAddr    destaddress;    // destination of the host with which the connection lies
-    CnetTimerID lasttimer;      // last timer linked to the connection
-    int         nextframe;      // seqno of the next frame to be sent
-    int		    ackexpected;    // ack expected
-    int 	    frameexpected;  // seqno of the next frame to be received
-    FRAME*	    lastframe;      // last frame that was transmitted
-    bool        is_broadcast;
-} CONN;
+//  SELECTIVE REPEAT: ONE OUTSTANDING FRAME HAS BEEN ACKNOWLEDGED, STOP ITS TIMER
+void window_acked(CONN *c, int seqno)
+{
+    int slot = seqno % windowsize;
 
-CONN conn[7];
-int numconn = 0;
+    c->acked[slot] = true;
+    if(c->sendtimer[slot] != NULLTIMER)
+        CNET_stop_timer(c->sendtimer[slot]);
+    c->sendtimer[slot] = NULLTIMER;
+}
 
-void initialize_connections()
+//  STOP-AND-WAIT: TRUE IF xmit WAS STAMPED BY THE PEER BEFORE last, THE FRAME ACCEPTED LAST (-1 IF NONE). WITH
+//  ALTERNATING SEQNOS A LATE COPY OF AN OLD FRAME OR ACK CAN CARRY THE SEQNO EXPECTED NOW, BUT THE PEER STAMPS ITS
+//  FRAMES IN THE ORDER IT SENDS THEM, SO NOT A TRANSMISSION NUMBER AS NEW AS THAT OF THE LAST ONE ACCEPTED
+bool stale_xmit(int last, unsigned short xmit)
 {
-    for (int i = 0; i < 7; i++)
-    {
-        conn[i].destaddress   = -1;
-        conn[i].lasttimer     = NULLTIMER;
-        conn[i].nextframe     = 0;
-        conn[i].ackexpected   = 0;
-        conn[i].frameexpected = 0;
-        conn[i].lastframe     = NULL;
-        conn[i].is_broadcast  = true;
-    }
+    return arqmode == ARQ_STOPANDWAIT && last != -1 && (int16_t)(xmit - last) < 0;
 }
 
-void initialize_routes()
+//  seqno IF IT NAMES A FRAME OF THE CONNECTION STILL OUTSTANDING, -1 OTHERWISE
+int outstanding(CONN *c, int seqno)
+{
+    return seqno != -1 && c->nbuffered > 0 && between(c->ackexpected, seqno, c->nextframe) ? seqno : -1;
+}
+
+//  AN ACK ARRIVED FOR A CONNECTION, SLIDE THE SEND WINDOW PAST EVERYTHING IT ACKNOWLEDGES. ack IS CUMULATIVE,
+//  sack (SELECTIVE REPEAT ONLY) NAMES ONE MORE FRAME RECEIVED OUT OF ORDER, BOTH ALREADY FOUND OUTSTANDING OR -1
+void window_ack(int connection, int ack, int sack)
 {
-    for(int i = 0; i < 42; i++)
+    CONN    *c = &conn[connection];
+    bool    cumulative = ack != -1;
+    bool    selective = sack != -1;
+
+    if(!cumulative && !selective)
+        return;
+
+//  MEASURE THE ROUND TRIP OF THE FRAME THAT PROMPTED THIS ACK, UNLESS IT WAS EVER RESENT
+    int sampled = (selective ? sack : ack) % windowsize;
+    if(!c->retransmitted[sampled] && !c->acked[sampled])
+        rtt_sample(connection, nodeinfo.time_in_usec - c->sendtime[sampled]);
+
+    if(arqmode != ARQ_SELECTIVEREPEAT)
+    {
+        while(cumulative && c->nbuffered > 0 && between(c->ackexpected, ack, c->nextframe))
+            window_retire(c);
+        CNET_stop_timer(c->lasttimer);
+        c->lasttimer = NULLTIMER;
+        if(c->nbuffered > 0)
+        {
+            int slot = c->ackexpected % windowsize;
+            int link = next_link(c->destaddress);
+            c->lasttimer = CNET_start_timer(EV_TIMER1, conn_rto(connection, link == -1 ? nodeinfo.nlinks : link, c->sendframe[slot].len), TIMER_DATA(connection, 0));
+        }
+    }
+    else
     {
-        routes[i].incoming_link = -1;
-        routes[i].outgoing_link = -1;
-        routes[i].source = -1;
-        routes[i].destination = -1;
+//  SELECTIVE REPEAT MARKS EVERY FRAME UP TO THE CUMULATIVE ACK, AND THE FRAME THE SELECTIVE ACK NAMES.
+//  THE WINDOW ONLY MOVES ONCE ITS LOWER EDGE IS ACKED
+        for(int seqno = c->ackexpected; cumulative; increment(seqno))
+        {
+            window_acked(c, seqno);
+            if(seqno == ack)
+                break;
+        }
+        if(selective)
+            window_acked(c, sack);
+        while(c->nbuffered > 0 && c->acked[c->ackexpected % windowsize])
+            window_retire(c);
     }
 }
 
-
-int check_conn(int destaddr)
+//  HAND THE PAYLOAD OF THE DATA FRAME frameexpected TO THE APPLICATION, MESSAGE BY MESSAGE IF IT IS A BATCH
+void deliver(CONN *c, unsigned char *payload, size_t length, bool batched)
 {
-    for(int i = 0; i < numconn; i++)
+    unsigned char   *end = payload + length;
+    uint32_t        len = length;
+
+    while(payload < end)
     {
-        if(conn[i].destaddress == destaddr)
-            return i;
+        if(batched && ((payload = get_varint(payload, end, &len)) == NULL || len > (size_t)(end - payload)))
+            break;
+
+        size_t written = len;
+        CHECK(CNET_write_application(payload, &written));
+        TRACE(TR_DELIVERED, DL_DATA, c->destaddress, nodeinfo.address, c->frameexpected, -1, 0, written, 0);
+        payload += len;
     }
-    return -1;
 }
 
-int check_route(CnetAddr source, CnetAddr destination)
+//  FEC: KEEP WHAT ARRIVED WITH A SEQNO UNTIL THE SEQNO COMES ROUND AGAIN, FOR THE PARITY OF ITS BLOCK TO USE
+void fec_store(CONN *c, FRAME *frame)
 {
-    for(int i = 0; i < numroute; i++)
+    unsigned char *payload = frame_payload(frame);
+
+    int             slot = FEC_SLOT(frame->seq);
+
+    if(payload != (unsigned char *)&c->fecstore[slot])
     {
-        if(routes[i].source == source && routes[i].destination == destination)
-        {
-            return i;
-        }
+        memcpy(&c->fecstore[slot], payload, frame->len);
+        payloadcopies++;
     }
-    return -1;
+    c->feclen[slot]     = frame->len;
+    c->fecbatched[slot] = frame->batched;
+    c->fecsum[slot]     = frame->payloadsum;
 }
 
-int check_incoming(CnetAddr source, CnetAddr destination)
+//  A DATA FRAME ARRIVED FOR A CONNECTION, DELIVER WHAT IS IN ORDER AND RETURN TRUE IF THE FRAME WAS
+//  THE NEXT ONE EXPECTED, SO THAT ITS ACK MAY WAIT. ANYTHING ELSE IS ACKED AT ONCE
+bool window_data(int connection, FRAME *frame)
 {
-    for(int i = 0; i < numroute; i++)
+    CONN    *c = &conn[connection];
+
+    if(arqmode != ARQ_SELECTIVEREPEAT)
     {
-        if(routes[i].source == source && routes[i].destination == destination)
+//  GO-BACK-N DISCARDS ANYTHING OUT OF ORDER
+        if(frame->seq == c->frameexpected && !stale_xmit(c->dataxmit, frame->xmit))
         {
-            return routes[i].incoming_link;
+            deliver(c, frame_payload(frame), frame->len, frame->batched);
+            increment(c->frameexpected);
+            c->ackearned = true;
+            c->dataxmit  = frame->xmit;
+            return true;
         }
+        LOG(LOG_TRACE, "DATA received [delivered] and ignored, does not match seqno expected:(src= %i, dest= %i, seq= %i, ack=-1, msgLen= %li)\n", frame->source, frame->destination, frame->seq, frame->len);
+        TRACE_FRAME(TR_IGNORED, frame, 0, 0);
+        c->stats.duplicates++;
+        return false;
     }
-    return -1;
-}
 
-int check_outgoing(CnetAddr source, CnetAddr destination)
-{
-    for(int i = 0; i < numroute; i++)
+//  SELECTIVE REPEAT BUFFERS ANYTHING INSIDE THE RECEIVE WINDOW
+    bool    inorder = frame->seq == c->frameexpected;
+    int     slot = frame->seq % windowsize;
+    if(between(c->frameexpected, frame->seq, c->toofar) && !c->arrived[slot])
     {
-        if(routes[i].source == source && routes[i].destination == destination)
+        memcpy(&c->recvbuf[slot], frame_payload(frame), frame->len);
+        payloadcopies++;
+        c->recvlen[slot]  = frame->len;
+        c->recvbatched[slot] = frame->batched;
+        c->arrived[slot]  = true;
+        if(fec != FEC_NONE)
+            fec_store(c, frame);
+        while(c->arrived[c->frameexpected % windowsize])
         {
-            return routes[i].outgoing_link;
+            slot = c->frameexpected % windowsize;
+            deliver(c, (unsigned char *)&c->recvbuf[slot], c->recvlen[slot], c->recvbatched[slot]);
+            c->arrived[slot] = false;
+            increment(c->frameexpected);
+            increment(c->toofar);
+            c->ackearned = true;
+            c->fecexpected++;
         }
     }
-    return -1;
+    else
+    {
+        LOG(LOG_TRACE, "DATA received [delivered] and ignored, outside receive window:(src= %i, dest= %i, seq= %i, ack=-1, msgLen= %li)\n", frame->source, frame->destination, frame->seq, frame->len);
+        TRACE_FRAME(TR_IGNORED, frame, 0, 0);
+        c->stats.duplicates++;
+        inorder = false;
+    }
+    return inorder;
 }
 
-bool check_hops(FRAME frame)
+//  SEND THE ACK OWED ON A CONNECTION IN A FRAME OF ITS OWN, sack AS IN window_ack
+void send_ack(int connection, int link, int sack)
 {
-    for(int i = 0; i < frame.lenhops; i++)
+    CONN        *c = &conn[connection];
+    CnetAddr    hops[7] = {-1,-1,-1,-1,-1,-1,-1};
+    int         ack = CUMULATIVE_ACK(c);
+
+    if(c->ackpending)
     {
-        if(frame.hops[i] == nodeinfo.address)
-            return true;
+        CNET_stop_timer(c->acktimer);
+        c->acktimer     = NULLTIMER;
+        c->ackpending   = false;
     }
-    return false;
-}
+//  NOTHING DELIVERED YET AND NOTHING TO ACK SELECTIVELY, SO THERE IS NOTHING TO SAY
+    if(ack == -1 && sack == -1)
+        return;
+    standalone++;
+    LOG(LOG_TRACE, "ACK sent: (src= %i, dest= %i, seq= %i, ack= %i, msgLen= %i, to link: %i)\n", nodeinfo.address, c->destaddress, sack, ack, 0, link);
 
-//  SOME HELPFUL MACROS FOR COMMON CALCULATIONS
-#define FRAME_HEADER_SIZE	(sizeof(FRAME) - sizeof(MSG))
-#define FRAME_SIZE(frame)	(FRAME_HEADER_SIZE + frame.len)
-#define increment(seq)		seq = 1-seq
+    FRAME   frame;
+    size_t  length;
+    int     probe = probe_link(check_route(nodeinfo.address, c->destaddress), -1, link);
 
+    build_frame(&frame, DL_ACK, nodeinfo.address, c->destaddress, NULL, 0, sack, ack, true, hops, 0, -1);
+    length = write_frame(link, &frame, CONN_OWNER(connection));
+    TRACE_FRAME(TR_SENT, &frame, link, length);
+//  THE PROBE IS THE SAME TRANSMISSION, SO WHICHEVER COPY ARRIVES SECOND IS A DUPLICATE
+    if(probe != -1)
+    {
+        length = write_frame(probe, &frame, CONN_OWNER(connection));
+        TRACE_FRAME(TR_SENT, &frame, probe, length);
+        c->stats.flooded++;
+        linkstats[probe].flooded++;
+    }
+}
 
-//  STATE VARIABLES HOLDING INFORMATION ABOUT THE LAST MESSAGE
-MSG       	lastmsg;
-size_t		lastmsglength	= 0;
-CnetTimerID	broadcasttimer		= NULLTIMER;
+//  FEC: A PARITY FRAME ARRIVED, SEE fec_flush. ONCE AS MANY PARITY FRAMES OF ITS BLOCK ARE HELD AS FRAMES OF
+//  THE BLOCK ARE MISSING FROM THE RECEIVE WINDOW, THOSE ARE REBUILT, TAKEN AS RECEIVED AND ACKED
+void fec_receive(int connection, FRAME *frame, int link)
+{
+    CONN            *c = &conn[connection];
+    unsigned char   *p = frame_payload(frame);
+    int             n = frame->len >= FEC_HEADER(0) ? p[4] : 0;
+    unsigned char   prefix[FEC_MAX_DATA][FEC_PREFIX];
+    unsigned char   *prefixes[FEC_MAX_DATA];
+    unsigned char   *payloads[FEC_MAX_DATA];
+    size_t          prefixlen[FEC_MAX_DATA];
+    size_t          lengths[FEC_MAX_DATA];
+    uint32_t        sums[FEC_MAX_DATA];
+    bool            missing[FEC_MAX_DATA];
+    unsigned char   *parityprefixes[FEC_MAX_PARITY];
+    unsigned char   *paritypayloads[FEC_MAX_PARITY];
+    int             e = 0;
 
-//  STATE VARIABLES HOLDING SEQUENCE NUMBERS
-int 	lastdestination;
+    if(c->fecstore == NULL || n < 1 || n > FEC_MAX_DATA || p[5] >= FEC_MAX_PARITY ||
+       frame->len < (size_t)FEC_HEADER(n) + FEC_PREFIX)
+        return;
 
-//  A FUNCTION TO TRANSMIT EITHER A DATA OR AN ACKNOWLEDGMENT FRAME
-FRAME transmit_frame(CnetAddr source, CnetAddr destination, MSG *msg, size_t length, int seqno, int ack, int link, bool timer, bool broadcast, bool hop, CnetAddr hops[7], int lenhops)
-{
-    FRAME   frame;
+//  SEQNOS WRAP, SO A BLOCK IS ONLY TOLD APART FROM AN OLDER ONE WITH THE SAME SEQNOS BY ITS UNWRAPPED FIRST SEQNO.
+//  ONLY A BLOCK WITHIN A WINDOW EITHER SIDE OF frameexpected HAS ITS FRAMES STILL IN fecstore OR AWAITED
+    uint32_t first = p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+    if((int32_t)(first - c->fecexpected) < -windowsize || (int32_t)(first + n - c->fecexpected) > windowsize)
+        return;
 
-    //  INITIALISE THE FRAME'S HEADER FIELDS
-    frame.source        = source;
-    frame.destination   = destination;
-    frame.seq           = seqno;
-    frame.ack           = ack;
-    frame.len           = length;
-    frame.checksum      = 0;
-    memcpy(frame.hops, hops, sizeof(int)*7);
-    frame.lenhops       = lenhops;
-    if(hop)
+//  A PARITY FRAME OF ANOTHER BLOCK REPLACES THOSE HELD
+    size_t symlen = frame->len - FEC_HEADER(n);
+    if(c->fecnparity > 0 && (c->fecparitylen != symlen || memcmp(c->fecblockid, p, 5) != 0 ||
+                             memcmp(c->fecblockid + 6, p + 6, 4*n) != 0))
+        c->fecnparity = 0;
+    for(int r = 0; r < c->fecnparity; r++)
     {
-        frame.hops[lenhops] = nodeinfo.address;
-        frame.lenhops++;
+        if(c->fecrows[r] == p[5])
+            return;
     }
+    if(c->fecnparity == FEC_MAX_PARITY)
+        return;
+    memcpy(c->fecblockid, p, FEC_HEADER(n));
+    memcpy(&c->fecparitybuf[c->fecnparity], p + FEC_HEADER(n), symlen);
+    payloadcopies++;
+    c->fecrows[c->fecnparity++] = p[5];
+    c->fecparitylen = symlen;
 
-    if(ack == -1)
+//  A FRAME OF THE BLOCK IS MISSING WHILE IT IS STILL AWAITED, EVERY OTHER MUST BE THE ONE THE PARITY COVERS
+    for(int i = 0, seqno = first % (maxseq + 1); i < n; i++, increment(seqno))
     {
-        if (timer)
+        sums[i]     = p[6 + 4*i] | p[7 + 4*i] << 8 | p[8 + 4*i] << 16 | (uint32_t)p[9 + 4*i] << 24;
+        missing[i]  = (int32_t)(first + i - c->fecexpected) >= 0 && !c->arrived[seqno % windowsize];
+        prefixes[i] = prefix[i];
+        prefixlen[i] = FEC_PREFIX;
+        payloads[i] = (unsigned char *)&c->fecstore[FEC_SLOT(seqno)];
+        lengths[i]  = c->feclen[FEC_SLOT(seqno)];
+        if(missing[i])
         {
-            CnetTime	timeout;
-            timeout     = FRAME_SIZE(frame)*((CnetTime)8000000 / linkinfo[link].bandwidth) + linkinfo[link].propagationdelay;
-            if (broadcast)
-                broadcasttimer = CNET_start_timer(EV_TIMER1, 10*timeout, 0);
-            else
-                conn[check_conn(destination)].lasttimer = CNET_start_timer(EV_TIMER1, 10* timeout, 0);
+            e++;
+            continue;
         }
-    	memcpy(&frame.msg, msg, length);
+        if(c->fecsum[FEC_SLOT(seqno)] != sums[i])
+            return;
+        prefix[i][0] = c->feclen[FEC_SLOT(seqno)] & 0xff;
+        prefix[i][1] = c->feclen[FEC_SLOT(seqno)] >> 8;
+        prefix[i][2] = c->fecbatched[FEC_SLOT(seqno)];
     }
+    if(e == 0 || e > c->fecnparity)
+        return;
 
-//  FINALLY, WRITE THE FRAME TO THE PHYSICAL LAYER
-    length		    = FRAME_SIZE(frame);
-    frame.checksum	= CNET_ccitt((unsigned char *)&frame, length);
-    CHECK(CNET_write_physical(link, &frame, &length));
-    return frame;
+    for(int r = 0; r < c->fecnparity; r++)
+    {
+        parityprefixes[r] = (unsigned char *)&c->fecparitybuf[r];
+        paritypayloads[r] = parityprefixes[r] + FEC_PREFIX;
+    }
+    if(!fec_decode(fec, prefixes, prefixlen, missing, n, parityprefixes, c->fecrows, c->fecnparity, FEC_PREFIX) ||
+       !fec_decode(fec, payloads, lengths, missing, n, paritypayloads, c->fecrows, c->fecnparity, symlen - FEC_PREFIX))
+        return;
+
+//  A REBUILT FRAME IS ONLY TRUSTED IF IT HAS THE CHECKSUM ITS ORIGINAL HAD, IT IS THEN RECEIVED FROM WHERE IT WAS
+//  REBUILT, fecstore
+    for(int i = 0, seqno = first % (maxseq + 1); i < n; i++, increment(seqno))
+    {
+        CnetAddr    hops[7] = {-1,-1,-1,-1,-1,-1,-1};
+        size_t      len = prefix[i][0] | prefix[i][1] << 8;
+        FRAME       rebuilt;
+
+        if(!missing[i])
+            continue;
+        if(len > symlen - FEC_PREFIX || cksum->fn(0, payloads[i], len) != sums[i])
+        {
+            LOG(LOG_WARN, "DATA rebuilt from parity is damaged: (src= %i, seq= %i)\n", c->destaddress, seqno);
+            continue;
+        }
+        build_frame(&rebuilt, DL_DATA, c->destaddress, nodeinfo.address, NULL, len, seqno, -1, false, hops, 0, frame->xmit);
+        rebuilt.batched         = prefix[i][2];
+        rebuilt.wire            = payloads[i];
+        rebuilt.wirelen         = len;
+        rebuilt.payloadat       = 0;
+        rebuilt.payloadsum      = sums[i];
+        rebuilt.payloadsummed   = true;
+        fecrebuilt++;
+        LOG(LOG_INFO, "DATA rebuilt from parity: (src= %i, dest= %i, seq= %i, msgLen= %li)\n", rebuilt.source, rebuilt.destination, seqno, len);
+        window_data(connection, &rebuilt);
+        send_ack(connection, link, seqno);
+    }
 }
 
-//  THE APPLICATION LAYER HAS A NEW MESSAGE TO BE DELIVERED
-EVENT_HANDLER(application_ready)
+//  A NAK NAMED A FRAME WHOSE PAYLOAD WAS CORRUPTED ON THE WAY, RESEND IT WITHOUT WAITING FOR ITS TIMER
+void window_nak(int connection, int seqno)
 {
-    CnetAddr destaddr;
-    lastmsglength  = sizeof(MSG);
-    CHECK(CNET_read_application(&destaddr, &lastmsg, &lastmsglength));
+    CONN    *c = &conn[connection];
+    int     slot = seqno % windowsize;
 
-    lastdestination = destaddr;
-    CNET_disable_application(ALLNODES);
+    if(c->nbuffered == 0 || !between(c->ackexpected, seqno, c->nextframe) || c->acked[slot])
+        return;
+//  A FLOODED FRAME CAN BE NAKED BY SEVERAL NODES, ONLY THE FIRST NAK AFTER A TRANSMISSION COUNTS
+    if(nodeinfo.time_in_usec - c->xmittime[slot] < c->srtt / 2)
+        return;
 
-    CnetAddr hops[7] = {-1,-1,-1,-1,-1,-1,-1};
-    int link = check_outgoing(nodeinfo.address, destaddr);
-    int connection = check_conn(destaddr);
-    if (link == -1)
+    LOG(LOG_INFO, "NAK received: (dest= %i, seq= %i), resending\n", c->destaddress, seqno);
+    if(arqmode != ARQ_SELECTIVEREPEAT)
     {
-        printf("Link unknown, transmitting to every node\n");
-        for(int i = 1; i <= nodeinfo.nlinks; i++)
+//  GO-BACK-N'S RECEIVER DISCARDS EVERYTHING AFTER THE LOST FRAME, SO EVERYTHING FROM IT IS RESENT
+        for(; seqno != c->nextframe; increment(seqno))
         {
-            printf("DATA generated and transmitted: (src= %i, dest= %i, seq= %i, ack= %i, msgLen= %li, to link: %i)\n", nodeinfo.address, destaddr, 0, -1, lastmsglength, i);
-            if (i == nodeinfo.nlinks)
-                transmit_frame(nodeinfo.address, destaddr, &lastmsg, lastmsglength , 0, -1, i, true, true, true, hops, 0);
-            else
-                transmit_frame(nodeinfo.address, destaddr, &lastmsg, lastmsglength , 0, -1, i, false, false, true, hops, 0);
+            c->retransmitted[seqno % windowsize] = true;
+            c->stats.retransmits++;
+            nakresent++;
+            window_transmit(connection, seqno);
         }
     }
     else
     {
-        printf("DATA generated and transmitted: (src= %i, dest= %i, seq= %i, ack= %i, msgLen= %li, to link: %i)\n", nodeinfo.address, destaddr, conn[connection].nextframe, -1, lastmsglength, link);
-        FRAME lastframe = transmit_frame(nodeinfo.address, destaddr, &lastmsg, lastmsglength , conn[connection].nextframe, -1, link, true, false, true, hops, 0);
-        conn[connection].lastframe = &lastframe;
-        conn[connection].is_broadcast = false;
+        c->retransmitted[slot] = true;
+        c->stats.retransmits++;
+        nakresent++;
+        window_transmit(connection, seqno);
     }
-    
 }
 
-//  PROCESS THE ARRIVAL OF A NEW FRAME, VERIFY CHECKSUM, ACT ON ITS FRAMEKIND
-EVENT_HANDLER(physical_ready)
+//  THE HEADER OF A DATA FRAME ARRIVED INTACT BUT ITS PAYLOAD DID NOT. NAK IT TO ITS SOURCE ON BEHALF
+//  OF ITS DESTINATION, WHICH IS THIS NODE UNLESS THE FRAME IS BEING RELAYED
+void send_nak(FRAME *frame, int link)
+{
+    CnetAddr    hops[7] = {-1,-1,-1,-1,-1,-1,-1};
+
+    if(frame->kind != DL_DATA || frame->seq == -1 || frame->source == nodeinfo.address)
+        return;
+    naksent++;
+    LOG(LOG_INFO, "NAK sent: (src= %i, dest= %i, seq= %i, to link: %i)\n", frame->destination, frame->source, frame->seq, link);
+    transmit_frame(TR_SENT, DL_NAK, frame->destination, frame->source, NULL, 0, frame->seq, -1, link, nodeinfo.nodetype == NT_HOST, hops, 0, -1);
+}
+
+//  A FRAME ADDRESSED TO THIS NODE ARRIVED, length BYTES OF IT ON THE WIRE
+void window_physical(FRAME *frame, int link, size_t length)
 {
-    FRAME       frame;
-    int         link, arriving_checksum;
-    size_t	    len = sizeof(FRAME);
+    int connection = open_conn(frame->source);
+
+    conn[connection].stats.framesreceived++;
+    conn[connection].stats.bytesreceived += length;
+    TRACE_FRAME(TR_RECEIVED, frame, link, length);
+    learn_route(frame->destination, frame->source, link);
+    if(dupcache)
+        follow_route(frame->source, frame->destination, link);
+
+//  THE ACK PART FIRST, A DATA FRAME MAY CARRY ONE TOO. AN ACK FRAME'S seq IS A SELECTIVE ACK. ONLY A FRAME
+//  STILL OUTSTANDING CAN BE ACKNOWLEDGED: ANY OTHER SEQNO IS A LATE COPY OF AN OLD ACK, AND IS DROPPED HERE
+    CONN    *c = &conn[connection];
+    bool    stale = stale_xmit(c->ackxmit, frame->xmit);
+    int     ack = stale ? -1 : outstanding(c, frame->ack);
+    int     sack = frame->kind == DL_ACK && !stale ? outstanding(c, frame->seq) : -1;
 
-//  RECEIVE THE NEW FRAME
-    CHECK(CNET_read_physical(&link, &frame, &len));
+    if(ack != -1)
+        c->ackxmit = frame->xmit;
 
-//  CALCULATE THE CHECKSUM OF THE ARRIVING FRAME, IGNORE IF INVALID
-    arriving_checksum	= frame.checksum;
-    frame.checksum  	= 0;
-    if(CNET_ccitt((unsigned char *)&frame, len) != arriving_checksum) 
+    if((frame->ack != -1 || (frame->kind == DL_ACK && frame->seq != -1)) && ack == -1 && sack == -1)
     {
-        printf("BAD frame received: checksums (stored= %i, computed= %i)\n", arriving_checksum, CNET_ccitt((unsigned char *)&frame, len));
-        return;           // bad checksum, just ignore frame
+        LOG(LOG_TRACE, "ACK not expected, ack seq no: %i\n", frame->ack);
+        TRACE(TR_IGNORED, DL_ACK, c->destaddress, nodeinfo.address, frame->kind == DL_ACK ? frame->seq : -1, frame->ack, 0, 0, 0);
     }
-    
-    if(nodeinfo.address == frame.destination)
+    if(frame->kind == DL_ACK)
+    {
+        LOG(LOG_TRACE, "ACK received [delivered]:(src = %i, dest= %i, seq= %i, ack=%i, msgLen= 0, from link= %i)\n", frame->source, frame->destination, frame->seq, frame->ack, link);
+        window_ack(connection, ack, sack);
+    }
+    else if(frame->kind == DL_NAK)
+        window_nak(connection, frame->seq);
+    else
+        window_ack(connection, ack, -1);
+
+//  THEN THE DATA PART, WHOSE ACK WAITS UP TO ackdelay FOR A FRAME GOING BACK, BUT NEVER FOR A SECOND ONE
+    if(frame->parity)
+        fec_receive(connection, frame, link);
+    else if(frame->kind == DL_DATA)
     {
-        if(frame.seq == -1)
+        LOG(LOG_TRACE, "DATA received [delivered]:(src= %i, dest= %i, seq= %i, ack=%i, msgLen= %li, link= %i)\n", frame->source, frame->destination, frame->seq, frame->ack, frame->len, link);
+        if(window_data(connection, frame) && ackdelay > 0 && !c->ackpending)
         {
-            int connection = check_conn(frame.source);
-            if(connection == -1)
-            {
-                if(frame.ack == conn[numconn].ackexpected)
-                {
-                    CNET_stop_timer(broadcasttimer);
-                    printf("ACK received [delivered]:(src = %i, dest= %i, seq= -1, ack=%i, msgLen= 0, from link= %i)\n", frame.source, frame.destination, frame.ack, link);
-                    printf("connection setup\n");
-                    conn[numconn].destaddress = frame.source;
-                    increment(conn[numconn].nextframe);
-                    increment(conn[numconn].ackexpected);
-                    numconn++;
-
-                    routes[numroute].source = frame.source;
-                    routes[numroute].destination = frame.destination;
-                    routes[numroute].incoming_link = link;
-                    routes[numroute].outgoing_link = link;
-                    numroute++;
-
-                    routes[numroute].source = frame.destination;
-                    routes[numroute].destination = frame.source;
-                    routes[numroute].incoming_link = link;
-                    routes[numroute].outgoing_link = link;
-                    numroute++;
-                    CNET_enable_application(ALLNODES);
-                }
-                else
-                {
-                    printf("ACK not expected, ack seq no: %i\n", frame.ack);
-                }
-            }
-            else
-            {
-                if(conn[connection].ackexpected == frame.ack)
-                {
-                    if(conn[connection].is_broadcast)
-                    {
-                        CNET_stop_timer(broadcasttimer);
-                    }
-                    else
-                    {
-                        CNET_stop_timer(conn[connection].lasttimer);
-                    }
-                    printf("ACK received [delivered]:(src = %i, dest= %i, seq= -1, ack=%i, msgLen= 0)\n", frame.source, frame.destination, frame.ack);
-                    increment(conn[connection].nextframe);
-                    increment(conn[connection].ackexpected);
-                    CNET_enable_application(ALLNODES);
-                }
-                else
-                {
-                    printf("ACK not expected, ack seq no: %i\n", frame.ack);
-                }
-            }
+            c->ackpending   = true;
+            c->acklink      = link;
+            c->acktimer     = CNET_start_timer(EV_TIMER3, ackdelay, connection);
         }
         else
-        {       
-            int connection = check_conn(frame.source);
-            if(connection == -1)
-            {
-                if(conn[numconn].frameexpected == frame.seq)
-                {
-                    printf("DATA received [delivered]:(src= %i, dest= %i, seq= %i, ack=-1, msgLen= %li, link= %i)\n", frame.source, frame.destination, frame.seq, frame.len, link);
-                    printf("ACK sent: (src= %i, dest= %i, seq= %i, ack= %i, msgLen= %i, to link: %i)\n", nodeinfo.address, frame.source, -1, frame.seq, 0, link);
-                    len = frame.len;
-                    CHECK(CNET_write_application(&frame.msg, &len));
-
-                    conn[numconn].destaddress = frame.source;
-                    increment(conn[numconn].frameexpected);
-                    numconn++;
-
-                    routes[numroute].source = frame.source;
-                    routes[numroute].destination = frame.destination;
-                    routes[numroute].incoming_link = link;
-                    routes[numroute].outgoing_link = link;
-                    numroute++;
-
-                    routes[numroute].source = frame.destination;
-                    routes[numroute].destination = frame.source;
-                    routes[numroute].incoming_link = link;
-                    routes[numroute].outgoing_link = link;
-                    numroute++;
-                }
-                else
-                {
-                    printf("DATA received [delivered] and ignored, does not match seqno expected:(src= %i, dest= %i, seq= %i, ack=-1, msgLen= %li, link= %i)\n", frame.source, frame.destination, frame.seq, frame.len, link);
-                    printf("ACK sent for wrong frame: (src= %i, dest= %i, seq= %i, ack= %i, msgLen= %i, to link: %i)\n", nodeinfo.address, frame.source, -1, frame.seq, 0, link);
-                }
-            } 
-            else
-            {
-                if(conn[connection].frameexpected == frame.seq)
-                {
-                    printf("DATA received [delivered]:(src= %i, dest= %i, seq= %i, ack=-1, msgLen= %li, link= %i)\n", frame.source, frame.destination, frame.seq, frame.len, link);
-                    printf("ACK sent: (src= %i, dest= %i, seq= %i, ack= %i, msgLen= %i, to link: %i)\n", nodeinfo.address, frame.source, -1, frame.seq, 0, link);
-                    len = frame.len;
-                    CHECK(CNET_write_application(&frame.msg, &len));
-                    increment(conn[connection].frameexpected);
-                }
-                else
-                {
-                    printf("DATA received [delivered] and ignored, does not match seqno expected:(src= %i, dest= %i, seq= %i, ack=-1, msgLen= %li, link= %i)\n", frame.source, frame.destination, frame.seq, frame.len, link);
-                    printf("ACK sent for wrong frame: (src= %i, dest= %i, seq= %i, ack= %i, msgLen= %i, to link: %i)\n", nodeinfo.address, frame.source, -1, frame.seq, 0, link);
-                }
-            }
-            CnetAddr hops[7] = {-1,-1,-1,-1,-1,-1,-1};
-            
+            send_ack(connection, link, arqmode == ARQ_SELECTIVEREPEAT ? frame->seq : -1);
+    }
+
+//  THE ACK MAY HAVE OPENED THE SEND WINDOW, AND ANY FRAME SENT NOW CARRIES THE ACK JUST OWED
+    window_send(connection);
+}
+
+//  NO DATA WENT BACK IN TIME TO CARRY AN ACK, SO IT GOES ON ITS OWN
+EVENT_HANDLER(delayed_ack)
+{
+    CONN    *c = &conn[data];
+
+    if(!c->ackpending || c->acktimer != timer)
+        return;         // already piggybacked
+    c->acktimer = NULLTIMER;
+    send_ack(data, c->acklink, -1);
+}
+
+//  A RETRANSMISSION TIMER EXPIRED, ITS CnetData NAMES THE CONNECTION (AND SLOT) IT BELONGS TO
+EVENT_HANDLER(timeouts)
+{
+    int     connection = data / MAX_WINDOW;
+    int     slot = data % MAX_WINDOW;
+    CONN    *c = &conn[connection];
 
-            transmit_frame(frame.destination, frame.source, NULL, 0, -1, frame.seq, link, false, true, true, hops, 0);
+    if(arqmode != ARQ_SELECTIVEREPEAT)
+    {
+        if(c->lasttimer != timer)
+            return;         // stopped after it had already fired
+//  GO-BACK-N RESENDS EVERY OUTSTANDING FRAME, OLDEST FIRST
+        LOG(LOG_INFO, "timeout for: dest=%i, seq=%i, resending %i frames\n", c->destaddress, c->ackexpected, c->nbuffered);
+        TRACE_FRAME(TR_TIMEOUT, &c->sendframe[c->ackexpected % windowsize], 0, 0);
+        c->lasttimer = NULLTIMER;
+        if(c->backoff < MAX_BACKOFF)
+            c->backoff *= 2;
+        int seqno = c->ackexpected;
+        for(int n = 0; n < c->nbuffered; n++)
+        {
+            c->retransmitted[seqno % windowsize] = true;
+            c->stats.retransmits++;
+            window_transmit(connection, seqno);
+            increment(seqno);
         }
     }
     else
     {
-        if(check_hops(frame))
-                return;
-        printf("DATA received [delivered] and relayed as destination does not match current node:(src= %i, dest= %i, seq= %i, ack=-1, msgLen= %li, from link= %i, curnode= %i)\n", frame.source, frame.destination, frame.seq, frame.len, link, nodeinfo.address);
-        int route = check_route(frame.source, frame.destination);
-        if(route == -1)
-        {
-            routes[numroute].source = frame.source;
-            routes[numroute].destination = frame.destination;
-            routes[numroute].incoming_link = link;
-            route = numroute;
-            numconn++;
-        }
-        int outgoing = check_outgoing(frame.source, frame.destination);
-        if(outgoing == -1)
+        if(c->sendtimer[slot] != timer)
+            return;
+//  SELECTIVE REPEAT RESENDS ONLY THE FRAME WHOSE TIMER EXPIRED
+        int seqno = c->sendframe[slot].seq;
+        LOG(LOG_INFO, "timeout for: dest=%i, seq=%i, msglen: %li\n", c->destaddress, seqno, c->sendframe[slot].len);
+        TRACE_FRAME(TR_TIMEOUT, &c->sendframe[slot], 0, 0);
+        c->sendtimer[slot] = NULLTIMER;
+        if(c->backoff < MAX_BACKOFF)
+            c->backoff *= 2;
+        c->retransmitted[slot] = true;
+        c->stats.retransmits++;
+        c->fecloss += (1000 - c->fecloss) / 16;
+        window_transmit(connection, seqno);
+    }
+}
+
+//  A BLOCK DID NOT FILL UP WITHIN fecdelay, ITS PARITY GOES AS FAR AS IT GOT
+EVENT_HANDLER(fec_timer)
+{
+    if(conn[data].fectimer != timer)
+        return;
+    conn[data].fectimer = NULLTIMER;
+    fec_flush(data);
+}
+
+//  SEND THIS NODE'S DISTANCE VECTOR TO EVERY NEIGHBOUR, EACH ENTRY A ZIGZAG VARINT ADDRESS AND A COST BYTE
+void dv_advertise()
+{
+    MSG             msg;
+    unsigned char   *start = (unsigned char *)&msg;
+    CnetAddr        hops[7] = {-1,-1,-1,-1,-1,-1,-1};
+
+    for(int link = 1; link <= nodeinfo.nlinks; link++)
+    {
+        unsigned char *p = start;
+
+        for(int i = 0; i < numdvroute; i++)
         {
-            outgoing = check_incoming(frame.destination, frame.source);
-            if(outgoing == -1)
-            {
-                printf("Outgoing link unknown, transmitting to all links\n");
-                for(int i = 1; i <= nodeinfo.nlinks; i++)
-                    {
-                        printf("DATA transmitted: (src= %i, dest= %i, seq= %i, ack= %i, msgLen= %li, to link= %i, curnode= %i)\n", frame.source, frame.destination, frame.seq, frame.ack, frame.len, i, nodeinfo.address);
-                        transmit_frame(frame.source, frame.destination, &frame.msg, frame.len, frame.seq, frame.ack, i, false, false, true, frame.hops, frame.lenhops);
-                    }
-            }
-            else
+//  A HOST THAT DOES NOT ROUTE ONLY ANNOUNCES ITS OWN ADDRESS
+            if(!dv_participating() && dvroutes[i].link != 0)
+                continue;
+            p = put_varint(p, ZIGZAG(dvroutes[i].destination));
+//  SPLIT HORIZON WITH POISONED REVERSE: NEVER OFFER A ROUTE BACK OVER A LINK IT WAS LEARNT FROM
+            *p++ = linkset_has(&dvroutes[i].links, link) ? DV_INFINITY : dvroutes[i].cost;
+            if((size_t)(p - start) > sizeof(MSG) - (MAX_VARINT + 1))
             {
-                routes[route].outgoing_link = outgoing;
-                printf("Outgoing link known\n");
-                printf("DATA transmitted: (src= %i, dest= %i, seq= %i, ack= %i, msgLen= %li, to link= %i, curnode= %i)\n", frame.source, frame.destination, frame.seq, frame.ack, frame.len, outgoing, nodeinfo.address);
-                transmit_frame(frame.source, frame.destination, &frame.msg, frame.len, frame.seq, frame.ack, outgoing, false, false, true, frame.hops, frame.lenhops);
+                transmit_frame(TR_SENT, DL_ROUTING, nodeinfo.address, ALLNODES, &msg, p - start, -1, -1, link, false, hops, 0, -1);
+                p = start;
             }
         }
-        else
+        if(p > start)
+            transmit_frame(TR_SENT, DL_ROUTING, nodeinfo.address, ALLNODES, &msg, p - start, -1, -1, link, false, hops, 0, -1);
+    }
+}
+
+//  A NEIGHBOUR SENT ITS DISTANCE VECTOR, EVERYTHING IN IT IS ONE HOP FURTHER AWAY FROM HERE
+void dv_receive(FRAME *frame, int link)
+{
+    unsigned char   *p = frame_payload(frame);
+    unsigned char   *end = p + frame->len;
+    uint32_t        destination;
+    bool            changed = false;
+
+    if(!dv_participating())
+        return;
+    while(p < end && (p = get_varint(p, end, &destination)) != NULL && p < end)
+    {
+        int cost = *p++;
+
+        if(UNZIGZAG(destination) != nodeinfo.address)
+            changed |= dv_update(UNZIGZAG(destination), cost + 1, link);
+    }
+
+//  TRIGGERED UPDATE, SO THAT NEWS SPREADS WITHOUT WAITING FOR THE NEXT PERIOD
+    if(changed)
+    {
+        LOG(LOG_INFO, "ROUTING table changed at %li usec, %i destinations\n", (long)dvchanged, numdvroute);
+        dv_advertise();
+    }
+}
+
+//  WHEN THE NEXT HOPS OF A ROUTE WERE LAST HEARD FROM, BY AN ADVERT CONFIRMING IT OR BY ANY FRAME AT ALL ON ONE
+//  OF ITS LINKS. A NEIGHBOUR THAT LOSES THE ROUTE SAYS SO IN ITS NEXT ADVERT, SO ONLY SILENCE MEANS IT IS GONE.
+//  ON AN OTHERWISE IDLE LINK LOSING 1 FRAME IN 8, 3 ADVERTS IN A ROW WENT MISSING OFTEN ENOUGH TO MAKE ROUTES
+//  FLAP, HENCE DV_EXPIRE PERIODS OF SILENCE
+CnetTime dv_heard(DVROUTE *r)
+{
+    CnetTime heard = r->updated;
+
+    for(int i = 0; i < r->links.n; i++)
+        if(linkheard[r->links.link[i]] > heard)
+            heard = linkheard[r->links.link[i]];
+    return heard;
+}
+
+//  PERIODICALLY EXPIRE ROUTES WHOSE NEXT HOPS HAVE FALLEN SILENT, NOTE THE FIRST TABLE TO HOLD FOR DV_STABLE
+//  PERIODS, AND ADVERTISE
+EVENT_HANDLER(dv_timer)
+{
+    for(int i = 0; i < numdvroute; i++)
+    {
+        DVROUTE *r = &dvroutes[i];
+
+        if(r->link != 0 && r->cost < DV_INFINITY && nodeinfo.time_in_usec - dv_heard(r) > DV_EXPIRE*dvperiod)
         {
-            printf("Outgoing link known\n");
-            printf("DATA transmitted: (src= %i, dest= %i, seq= %i, ack= %i, msgLen= %li, to link= %i, curnode= %i)\n", frame.source, frame.destination, frame.seq, frame.ack, frame.len, outgoing, nodeinfo.address);
-            transmit_frame(frame.source, frame.destination, &frame.msg, frame.len, frame.seq, frame.ack, outgoing, false, false, true, frame.hops, frame.lenhops);
+            r->cost     = DV_INFINITY;
+            dvchanged   = nodeinfo.time_in_usec;
+            dvchanges++;
         }
     }
+    if(dvconverged == -1 && nodeinfo.time_in_usec - dvchanged >= DV_STABLE*dvperiod)
+        dvconverged = dvchanged;
+    dv_advertise();
+    CNET_start_timer(EV_TIMER2, dvperiod, 0);
 }
 
-EVENT_HANDLER(router_physical_ready)
+//  WRITE A FRAME BEING RELAYED TO link, AS IT ARRIVED IF IT STILL CAN BE, RETURNING ITS LENGTH ON THE WIRE
+size_t relay_write(FRAME *frame, int link, OWNER owner)
+{
+    size_t length = frame->wire != NULL ? write_wire(link, frame, frame->wire, frame->wirelen, owner) : write_frame(link, frame, owner);
+
+    TRACE_FRAME(TR_RELAYED, frame, link, length);
+    return length;
+}
+
+//  FORWARD A FRAME FOR ANOTHER NODE ON ITS KNOWN OUTGOING LINK, OR TO EVERY LINK WHILE THAT IS UNKNOWN.
+//  THE FRAME GOES OUT AS THE BYTES IT ARRIVED AS, WITH AT MOST A HOP PATCHED INTO THEM, AND IS NEVER COPIED
+void relay_frame(FRAME *frame, int link, bool hop)
 {
-    FRAME       frame;
-    int         link, arriving_checksum;
-    size_t	    len = sizeof(FRAME);
+    STATS   *stats;
+
+    framesrelayed++;
+    if(hop)
+        add_hop(frame);
 
-//  RECEIVE THE NEW FRAME
-    CHECK(CNET_read_physical(&link, &frame, &len));
+//  ONCE DISTANCE-VECTOR ROUTING HAS CONVERGED, NOTHING IS EVER FLOODED
+    int dvroute = dv_route(frame->destination);
+    if(dvroute != -1)
+    {
+        int outgoing = linkset_pick(&dvroutes[dvroute].links, frame->source, frame->destination);
 
-//  CALCULATE THE CHECKSUM OF THE ARRIVING FRAME, IGNORE IF INVALID
-    arriving_checksum	= frame.checksum;
-    frame.checksum  	= 0;
-    if(CNET_ccitt((unsigned char *)&frame, len) != arriving_checksum) {
-        printf("BAD frame received: checksums (stored= %i, computed= %i)\n", arriving_checksum, CNET_ccitt((unsigned char *)&frame, len));
-        return;           // bad checksum, just ignore frame
+        LOG(LOG_TRACE, "DATA transmitted on distance-vector route: (src= %i, dest= %i, seq= %i, ack= %i, msgLen= %li, to link= %i, curnode= %i)\n", frame->source, frame->destination, frame->seq, frame->ack, frame->len, outgoing, nodeinfo.address);
+        stats = &dvroutes[dvroute].stats;
+        stats->relayed++;
+        relay_write(frame, outgoing, DVROUTE_OWNER(dvroute));
+        linkstats[outgoing].relayed++;
+        return;
     }
 
-    printf("DATA received [delivered] and relayed:(src= %i, dest= %i, seq= %i, ack=-1, msgLen= %li, from link= %i, curnode= %i)\n", frame.source, frame.destination, frame.seq, frame.len, link, nodeinfo.address);
-    int route = check_route(frame.source, frame.destination);
+//  ONCE THE ROUTE IS LEARNT THIS IS THE ONLY TABLE LOOKUP THE FRAME COSTS
+    int route = check_route(frame->source, frame->destination);
     if(route == -1)
+        route = add_route(frame->source, frame->destination, link, -1);
+    else if(routes[route].incoming_link == -1)
+        routes[route].incoming_link = link;     // the route was made by learn_alternative
+    else if(dupcache)
+        follow_route(frame->source, frame->destination, link);
+
+    if(routes[route].outgoing.n == 0)
     {
-        routes[numroute].source = frame.source;
-        routes[numroute].destination = frame.destination;
-        routes[numroute].incoming_link = link;
-        route = numroute;
-        numroute++;
+//  FRAMES FLOWING THE OTHER WAY ARRIVE ON THE LINK THAT LEADS TO THIS DESTINATION
+        int reverse = check_route(frame->destination, frame->source);
+        if(reverse != -1)
+            linkset_add(&routes[route].outgoing, routes[reverse].incoming_link);
     }
-    int outgoing = check_outgoing(frame.source, frame.destination);
+    int outgoing = linkset_pick(&routes[route].outgoing, frame->source, frame->destination);
+
+    stats = &routes[route].stats;
+    stats->relayed++;
     if(outgoing == -1)
     {
-        outgoing = check_incoming(frame.destination, frame.source);
-        if(outgoing == -1)
+        LOG(LOG_TRACE, "Outgoing link unknown, transmitting to all links\n");
+        for(int i = 1; i <= nodeinfo.nlinks; i++)
         {
-            printf("Outgoing link unknown, transmitting to all links\n");
-            for(int i = 1; i <= nodeinfo.nlinks; i++)
-            {
-                printf("DATA transmitted: (src= %i, dest= %i, seq= %i, ack= %i, msgLen= %li, to link= %i)\n", frame.source, frame.destination, frame.seq, frame.ack, frame.len, i);
-                transmit_frame(frame.source, frame.destination, &frame.msg, frame.len, frame.seq, frame.ack, i, false, false, false, frame.hops, frame.lenhops);
-            }
+            LOG(LOG_TRACE, "DATA transmitted: (src= %i, dest= %i, seq= %i, ack= %i, msgLen= %li, to link= %i, curnode= %i)\n", frame->source, frame->destination, frame->seq, frame->ack, frame->len, i, nodeinfo.address);
+            relay_write(frame, i, ROUTE_OWNER(route));
+            stats->flooded++;
+            linkstats[i].flooded++;
         }
-        else
+    }
+    else
+    {
+        LOG(LOG_TRACE, "Outgoing link known\n");
+        LOG(LOG_TRACE, "DATA transmitted: (src= %i, dest= %i, seq= %i, ack= %i, msgLen= %li, to link= %i, curnode= %i)\n", frame->source, frame->destination, frame->seq, frame->ack, frame->len, outgoing, nodeinfo.address);
+        relay_write(frame, outgoing, ROUTE_OWNER(route));
+        linkstats[outgoing].relayed++;
+
+        int probe = frame->kind == DL_ACK ? probe_link(route, link, outgoing) : -1;
+        if(probe != -1)
         {
-            routes[route].outgoing_link = outgoing;
-            printf("Outgoing link known\n");
-            printf("DATA transmitted: (src= %i, dest= %i, seq= %i, ack= %i, msgLen= %li, to link= %i)\n", frame.source, frame.destination, frame.seq, frame.ack, frame.len, outgoing);
-            transmit_frame(frame.source, frame.destination, &frame.msg, frame.len, frame.seq, frame.ack, outgoing, false, false, false, frame.hops, frame.lenhops);
+            relay_write(frame, probe, ROUTE_OWNER(route));
+            stats->flooded++;
+            linkstats[probe].flooded++;
         }
     }
-    else
+}
+
+//  THE APPLICATION LAYER HAS A NEW MESSAGE TO BE DELIVERED, QUEUE IT ON THE CONNECTION TO ITS DESTINATION
+EVENT_HANDLER(application_ready)
+{
+    CnetAddr    destaddr;
+    MSG         *msg = malloc(sizeof(MSG));
+    size_t      length = sizeof(MSG);
+
+    CHECK(CNET_read_application(&destaddr, msg, &length));
+    LOG(LOG_TRACE, "DATA generated: (src= %i, dest= %i, msgLen= %li)\n", nodeinfo.address, destaddr, length);
+    TRACE(TR_GENERATED, DL_DATA, nodeinfo.address, destaddr, -1, -1, 0, length, 0);
+
+    int     connection = open_conn(destaddr);
+    CONN    *c = &conn[connection];
+    int     tail = (c->queuehead + c->queued) % MAX_QUEUE;
+
+    c->queue[tail]    = msg;
+    c->queuelen[tail] = length;
+    c->queuetime[tail] = nodeinfo.time_in_usec;
+    c->queued++;
+
+    window_send(connection);
+
+//  A FULL QUEUE STOPS NEW MESSAGES FOR THIS DESTINATION ONLY, THE OTHER CONNECTIONS KEEP FLOWING
+    if(c->queued == MAX_QUEUE)
     {
-        printf("Outgoing link known\n");
-        printf("DATA transmitted: (src= %i, dest= %i, seq= %i, ack= %i, msgLen= %li, to link= %i)\n", frame.source, frame.destination, frame.seq, frame.ack, frame.len, outgoing);
-        transmit_frame(frame.source, frame.destination, &frame.msg, frame.len, frame.seq, frame.ack, outgoing, false, false, false, frame.hops, frame.lenhops);
+        CNET_disable_application(destaddr);
+        c->throttled = true;
     }
 }
 
-//  WHEN A TIMEOUT OCCURS, WE RE-TRANSMIT THE MOST RECENT DATA (MESSAGE)
-EVENT_HANDLER(timeouts)
+//  PROCESS THE ARRIVAL OF A NEW FRAME, VERIFY CHECKSUM, ACT ON ITS FRAMEKIND
+EVENT_HANDLER(physical_ready)
 {
-    int link = check_outgoing(nodeinfo.address, lastdestination);
-    CnetAddr hops[7] = {-1,-1,-1,-1,-1,-1,-1};
-    if (link == -1)
+    FRAME           frame;
+    unsigned char   wire[MAX_WIRE_SIZE];
+    int             link;
+    size_t          length;
+
+//  RECEIVE AND DECODE THE NEW FRAME, IGNORE IT IF A CHECKSUM IS INVALID BUT NAK IT IF ONLY THE PAYLOAD'S IS
+    WIRESTATUS status = read_frame(&link, wire, &frame, &length);
+    if(status == WIRE_BADPAYLOAD)
     {
-        printf("timeout for: seq=0, msglen: %li\n", lastmsglength);
-        printf("retransmitting to all links\n");
-        for(int i = 1; i<= nodeinfo.nlinks; i++)
-        {
-            if(i == nodeinfo.nlinks)
-                transmit_frame(nodeinfo.address, lastdestination, &lastmsg, lastmsglength, 0, -1, i, true, true, true, hops, 0);
-            else
-                transmit_frame(nodeinfo.address, lastdestination, &lastmsg, lastmsglength, 0, -1, i, false, false, true, hops, 0);
-        }
+        int connection = frame.destination == nodeinfo.address ? check_conn(frame.source) : -1;
+
+        if(connection != -1)
+            conn[connection].stats.badchecksums++;
+        if(nak)
+            send_nak(&frame, link);
+    }
+    if(status != WIRE_OK)
+        return;
+
+    if(frame.kind == DL_ROUTING)
+    {
+        dv_receive(&frame, link);
+        return;
+    }
+
+//  DROP OUR OWN FRAMES FLOODED BACK TO US, AND EVERY FURTHER COPY OF A FLOODED FRAME
+    if(dupcache && (frame.source == nodeinfo.address || dup_seen(&frame, link)))
+    {
+        LOG(LOG_TRACE, "DUPLICATE frame dropped: (src= %i, dest= %i, seq= %i, ack= %i, from link= %i)\n", frame.source, frame.destination, frame.seq, frame.ack, link);
+        TRACE_FRAME(TR_DUPLICATE, &frame, link, length);
+        linkstats[link].duplicates++;
+        return;
+    }
+    if(nodeinfo.address == frame.destination)
+    {
+        window_physical(&frame, link, length);
     }
     else
     {
-        printf("timeout for: seq=%i, msglen: %li\n", conn[check_conn(lastdestination)].ackexpected, lastmsglength);
-        printf("retransmitting to known link\n");
-        transmit_frame(nodeinfo.address, lastdestination, &lastmsg, lastmsglength, conn[check_conn(lastdestination)].ackexpected, -1, link, true, false, true, hops, 0);
+        if(!dupcache && check_hops(&frame))
+                return;
+        LOG(LOG_TRACE, "DATA received [delivered] and relayed as destination does not match current node:(src= %i, dest= %i, seq= %i, ack=-1, msgLen= %li, from link= %i, curnode= %i)\n", frame.source, frame.destination, frame.seq, frame.len, link, nodeinfo.address);
+        relay_frame(&frame, link, true);
+    }
+}
+
+EVENT_HANDLER(router_physical_ready)
+{
+    FRAME           frame;
+    unsigned char   wire[MAX_WIRE_SIZE];
+    int             link;
+    size_t          length;
+
+//  RECEIVE AND DECODE THE NEW FRAME, IGNORE IT IF A CHECKSUM IS INVALID BUT NAK IT IF ONLY THE PAYLOAD'S IS
+    WIRESTATUS status = read_frame(&link, wire, &frame, &length);
+    if(status == WIRE_BADPAYLOAD && nak)
+        send_nak(&frame, link);
+    if(status != WIRE_OK)
+        return;
+
+    if(frame.kind == DL_ROUTING)
+    {
+        dv_receive(&frame, link);
+        return;
+    }
+    if(dupcache && dup_seen(&frame, link))
+    {
+        LOG(LOG_TRACE, "DUPLICATE frame dropped: (src= %i, dest= %i, seq= %i, ack= %i, from link= %i, curnode= %i)\n", frame.source, frame.destination, frame.seq, frame.ack, link, nodeinfo.address);
+        TRACE_FRAME(TR_DUPLICATE, &frame, link, length);
+        linkstats[link].duplicates++;
+        return;
+    }
+    LOG(LOG_TRACE, "DATA received [delivered] and relayed:(src= %i, dest= %i, seq= %i, ack=-1, msgLen= %li, from link= %i, curnode= %i)\n", frame.source, frame.destination, frame.seq, frame.len, link, nodeinfo.address);
+    relay_frame(&frame, link, false);
+}
+
+//  THE FIELDS OF A SET OF COUNTERS, TO FOLLOW THE FIELDS THAT SAY WHAT THEY COUNT
+void json_stats(STATS *s)
+{
+    printf(",\"frames_sent\":%li,\"bytes_sent\":%li,\"frames_received\":%li,\"bytes_received\":%li",
+           s->framessent, s->bytessent, s->framesreceived, s->bytesreceived);
+    printf(",\"relayed\":%li,\"flooded\":%li,\"retransmits\":%li,\"bad_checksums\":%li,\"duplicates\":%li",
+           s->relayed, s->flooded, s->retransmits, s->badchecksums, s->duplicates);
+}
+
+void json_links(LINKSET *s)
+{
+    printf("[");
+    for(int i = 0; i < s->n; i++)
+        printf("%s%i", i > 0 ? "," : "", s->link[i]);
+    printf("]");
+}
+
+//  WRITE EVERYTHING THIS NODE HAS COUNTED AS ONE LINE OF JSON, AT SHUTDOWN OR ON EV_DEBUG0
+EVENT_HANDLER(dump_metrics)
+{
+    printf("{\"node\":\"%s\",\"address\":%i,\"time_usec\":%li", nodeinfo.nodename, nodeinfo.address, (long)nodeinfo.time_in_usec);
+
+    printf(",\"links\":[");
+    for(int i = 1; i <= nodeinfo.nlinks; i++)
+    {
+        LINKQUEUE *q = &linkqueues[i];
+
+        printf("%s{\"link\":%i", i > 1 ? "," : "", i);
+        json_stats(&linkstats[i]);
+        printf(",\"utilization\":%.4f", nodeinfo.time_in_usec > 0 ? (double)q->busytime / nodeinfo.time_in_usec : 0.0);
+        printf(",\"queued\":%li,\"queue_peak\":%i,\"queue_drops\":%li,\"flows\":%i}", q->enqueued, q->peak, q->drops, q->numflow);
+    }
+
+    printf("],\"connections\":[");
+    for(int i = 0; i < numconn; i++)
+    {
+        CONN *c = &conn[i];
+
+        printf("%s{\"destination\":%i,\"rtt_samples\":%i,\"srtt_usec\":%li,\"rttvar_usec\":%li,\"min_rtt_usec\":%li,\"max_rtt_usec\":%li,\"rto_usec\":%li",
+               i > 0 ? "," : "", c->destaddress, c->rttsamples, (long)c->srtt, (long)c->rttvar,
+               (long)c->minrtt, (long)c->maxrtt, (long)conn_rto(i, 1, 0));
+        printf(",\"rtt_histogram_ms\":[");
+        for(int b = 0; b < RTT_BUCKETS; b++)
+            printf("%s%i", b > 0 ? "," : "", c->rtthist[b]);
+        printf("]");
+        json_stats(&c->stats);
+        printf("}");
+    }
+
+    printf("],\"routes\":[");
+    for(int i = 0; i < numroute; i++)
+    {
+        printf("%s{\"source\":%i,\"destination\":%i,\"incoming_link\":%i,\"outgoing_links\":",
+               i > 0 ? "," : "", routes[i].source, routes[i].destination, routes[i].incoming_link);
+        json_links(&routes[i].outgoing);
+        json_stats(&routes[i].stats);
+        printf("}");
+    }
+
+//  THE LATEST ACROSS ALL NODES IS WHEN THE NETWORK AS A WHOLE CONVERGED
+    printf("],\"dv_converged_usec\":%li,\"dv_changes\":%i,\"dv_routes\":[", (long)dvconverged, dvchanges);
+    for(int i = 0; i < numdvroute; i++)
+    {
+        printf("%s{\"destination\":%i,\"cost\":%i,\"links\":",
+               i > 0 ? "," : "", dvroutes[i].destination, dvroutes[i].cost);
+        json_links(&dvroutes[i].links);
+        json_stats(&dvroutes[i].stats);
+        printf("}");
     }
-    
+
+    printf("],\"acks_piggybacked\":%i,\"acks_alone\":%i,\"naks_sent\":%i,\"nak_resent\":%i",
+           piggybacked, standalone, naksent, nakresent);
+    printf(",\"batch_frames\":%i,\"batch_messages\":%i", batchframes, batchmsgs);
+    printf(",\"fec_parity_sent\":%i,\"fec_rebuilt\":%i", fecsent, fecrebuilt);
+    printf(",\"latency_messages\":%i,\"latency_mean_usec\":%li",
+           latencies, latencies > 0 ? (long)(latencysum / latencies) : 0L);
+    printf(",\"header_bytes_wire\":%li,\"header_bytes_struct\":%li", wireheaderbytes, structheaderbytes);
+    printf(",\"payload_copies\":%li,\"frames_relayed\":%li", payloadcopies, framesrelayed);
+    printf(",\"dup_evictions\":%li}\n", dupevictions);
+}
+
+//  AT THE END OF THE SIMULATION, WRITE OUT THE LAST OF THE TRACE AND THE METRICS
+EVENT_HANDLER(shutdown_node)
+{
+    if(tracebuf != NULL)
+    {
+        trace_flush();
+        fclose(tracefp);
+    }
+    dump_metrics(ev, timer, data);
 }
 
 //  THIS FUNCTION IS CALLED ONCE, AT THE BEGINNING OF THE WHOLE SIMULATION
 EVENT_HANDLER(reboot_node)
 {
-    
+    read_config();
+    linkstats = calloc(nodeinfo.nlinks + 1, sizeof(STATS));
+    linkheard = calloc(nodeinfo.nlinks + 1, sizeof(CnetTime));
+    initialize_queues();
+    if(tracing)
+        trace_open();
     if(nodeinfo.nodetype == NT_HOST)
     {
         initialize_connections();
@@ -495,11 +2837,23 @@ EVENT_HANDLER(reboot_node)
         CHECK(CNET_set_handler( EV_APPLICATIONREADY, application_ready, 0));
         CHECK(CNET_set_handler( EV_PHYSICALREADY,    physical_ready, 0));
         CHECK(CNET_set_handler( EV_TIMER1,           timeouts, 0));
+        CHECK(CNET_set_handler( EV_TIMER3,           delayed_ack, 0));
+        CHECK(CNET_set_handler( EV_TIMER5,           fec_timer, 0));
     }
     else if(nodeinfo.nodetype == NT_ROUTER)
     {
         CHECK(CNET_set_handler( EV_PHYSICALREADY,    router_physical_ready, 0));
     }
+    CHECK(CNET_set_handler( EV_TIMER4,           link_ready, 0));
+    CHECK(CNET_set_handler( EV_SHUTDOWN,         shutdown_node, 0));
+    CHECK(CNET_set_handler( EV_DEBUG0,           dump_metrics, 0));
+    CHECK(CNET_set_debug_string( EV_DEBUG0,      "Metrics"));
+    if(routing == ROUTING_DV)
+    {
+        initialize_dv();
+        CHECK(CNET_set_handler( EV_TIMER2,           dv_timer, 0));
+        CNET_start_timer(EV_TIMER2, 1000 * (nodeinfo.nodenumber + 1), 0);   // stagger the first updates
+    }
 
 //if(nodeinfo.nodenumber == 0)
 	CNET_enable_application(ALLNODES);
@@ -0,0 +1,52 @@
+//  THE BINARY EVENT TRACE THAT stopandwait.c WRITES WITH  var trace = "1"  AND trace/traceview READS.
+//  A TRACE FILE IS ONE TRACEHEADER FOLLOWED BY ANY NUMBER OF TRACERECS, BOTH IN THE BYTE ORDER OF THE
+//  HOST THAT WROTE THEM (A FILE FROM A HOST OF THE OTHER ORDER FAILS THE MAGIC NUMBER CHECK)
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <stdint.h>
+
+#define TRACE_MAGIC         0x52545753      // "SWTR"
+#define TRACE_VERSION       2
+
+//  WHAT A NODE RECORDED. THE FRAME FIELDS OF A RECORD ARE THOSE OF THE FRAME THE EVENT CONCERNS
+typedef enum {
+    TR_GENERATED,       // the application handed over a message, length is its size
+    TR_SENT,            // a frame this node built was written to link
+    TR_RESENT,          // a data frame was written again, after a timeout or a NAK
+    TR_RECEIVED,        // a frame addressed to this node arrived intact on link
+    TR_RELAYED,         // a frame for another node was written to link
+    TR_DELIVERED,       // a data frame's message went up to the application, length is its size
+    TR_ACKED,           // the data frame seq of the connection to destination was acknowledged
+    TR_TIMEOUT,         // the retransmission timer of seq on the connection to destination expired
+    TR_BADHEADER,       // a frame arrived on link with its header corrupted, only link and length are known
+    TR_BADPAYLOAD,      // a frame arrived on link with its payload corrupted
+    TR_DUPLICATE,       // the duplicate cache dropped a further copy of a frame
+    TR_IGNORED,         // an ACK that acknowledged nothing, or data outside the receive window
+    N_TRACEEVENTS
+} TRACEEVENT;
+
+typedef struct {
+    uint32_t    magic;
+    uint16_t    version;
+    uint16_t    recordsize;         // sizeof(TRACEREC)
+    int32_t     address;            // of the node that wrote the file
+    char        nodename[32];
+} TRACEHEADER;
+
+//  32 BYTES, SO THAT A RECORD IS A COUPLE OF STORES AND A FULL BUFFER ONE fwrite
+typedef struct {
+    int64_t     time;               // usec
+    int32_t     node;               // address of the node that recorded the event
+    int32_t     source;
+    int32_t     destination;
+    uint16_t    length;             // bytes on the wire, except as noted above
+    uint16_t    xmit;
+    uint16_t    link;
+    int16_t     seq;                // -1 if none
+    int16_t     ack;                // -1 if none
+    uint8_t     event;              // TRACEEVENT
+    uint8_t     kind;               // FRAMEKIND
+} TRACEREC;
+
+#endif
@@ -0,0 +1,604 @@
+//  READS THE BINARY TRACES THAT stopandwait.c WRITES WITH  var trace = "1", ONE FILE PER NODE, MERGES THEM
+//  INTO ONE TIMELINE AND REBUILDS WHAT HAPPENED ON EACH CONNECTION:
+//
+//      trace/traceview [-d] [-c addr,addr] trace.*.trc
+//
+//  FOR EVERY DIRECTION OF EVERY CONNECTION IT SUMMARIZES WHAT WAS SENT, RESENT, RECEIVED AND LOST, HOW LONG
+//  FRAMES SPENT IN FLIGHT (FROM THE SOURCE WRITING A TRANSMISSION TO THE DESTINATION READING THE SAME ONE,
+//  MATCHED ON ITS xmit), THE TIME BETWEEN SUCCESSIVE TRANSMISSIONS OF A FRAME, AND FROM ITS FIRST
+//  TRANSMISSION TO ITS ACK. -d ALSO DRAWS EACH CONNECTION AS A SEQUENCE DIAGRAM, ONE LANE PER NODE THE
+//  CONNECTION'S FRAMES TOUCHED, AND -c LIMITS EVERYTHING TO THE CONNECTION BETWEEN TWO ADDRESSES.
+//
+//  THE NODES OF A SIMULATION SHARE ONE CLOCK, SO THEIR TIMESTAMPS CAN BE COMPARED DIRECTLY.
+
+#include "../trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+//  THE KINDS OF FRAME, IN stopandwait.c's FRAMEKIND ORDER
+static const char *kindname[] = { "DATA", "ACK", "ROUTING", "NAK" };
+
+#define DL_DATA             0
+#define DL_ACK              1
+#define DL_ROUTING          2
+#define DL_NAK              3
+
+#define MAX_SEQ             16          // outstanding seqnos of one connection differ mod 16
+#define LANE_WIDTH          26
+
+//  EVERY RECORD OF EVERY FILE, IN TIME ORDER ONCE SORTED
+static TRACEREC     *recs       = NULL;
+static int          nrecs       = 0;
+static int          maxrecs     = 0;
+
+//  THE NAMES OF THE NODES, FROM THE HEADERS OF THEIR FILES
+typedef struct {
+    int32_t     address;
+    char        nodename[32];
+    long        badheaders;
+} NODE;
+
+static NODE         *nodes      = NULL;
+static int          nnodes      = 0;
+
+//  A GROWABLE SET OF MEASUREMENTS, IN MSEC
+typedef struct {
+    double      *v;
+    int         n;
+    int         max;
+} SAMPLES;
+
+//  ONE DIRECTION OF A CONNECTION: ITS DATA FLOWS ONE WAY, ITS ACKS AND NAKS THE OTHER
+typedef struct {
+    long        generated, delivered, acked;
+    long        datasent, dataresent, datareceived, datalost;
+    long        ackssent, ackspiggybacked, acksreceived, ackslost;
+    long        nakssent, naksreceived;
+    long        timeouts, ignoreddata, ignoredacks, badpayloads, duplicates, relayed;
+    SAMPLES     dataflight, ackflight, resendgap, sendtoack;
+    int64_t     firstsent[MAX_SEQ];
+    int64_t     lastsent[MAX_SEQ];
+} DIRECTION;
+
+//  A CONNECTION IS AN UNORDERED PAIR OF HOSTS, dir[0] CARRIES a's DATA TO b AND dir[1] b's TO a
+typedef struct {
+    int32_t     a, b;
+    DIRECTION   dir[2];
+} CONNECTION;
+
+static CONNECTION   *conns      = NULL;
+static int          nconns      = 0;
+
+//  EACH TRANSMISSION STILL IN FLIGHT, KEYED ON (source, destination, kind, xmit)
+typedef struct {
+    int32_t     source, destination;
+    uint16_t    xmit;
+    uint8_t     kind;
+    bool        used;
+    bool        arrived;
+    int64_t     time;
+} INFLIGHT;
+
+static INFLIGHT     *inflight   = NULL;
+static int          inflightcap = 0;
+static int          inflightused = 0;
+
+static void *xrealloc(void *p, size_t size)
+{
+    if((p = realloc(p, size)) == NULL)
+    {
+        fprintf(stderr, "traceview: out of memory\n");
+        exit(1);
+    }
+    return p;
+}
+
+static void sample(SAMPLES *s, double value)
+{
+    if(s->n == s->max)
+    {
+        s->max  = s->max ? 2*s->max : 64;
+        s->v    = xrealloc(s->v, s->max * sizeof(double));
+    }
+    s->v[s->n++] = value;
+}
+
+static int by_value(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void print_samples(const char *what, SAMPLES *s)
+{
+    if(s->n == 0)
+        return;
+
+    double sum = 0;
+    qsort(s->v, s->n, sizeof(double), by_value);
+    for(int i = 0; i < s->n; i++)
+        sum += s->v[i];
+    printf("  %-22s n= %-6i mean= %.3f  p50= %.3f  p95= %.3f  max= %.3f ms\n", what, s->n, sum / s->n,
+           s->v[(s->n - 1) / 2], s->v[(int)(0.95 * (s->n - 1))], s->v[s->n - 1]);
+}
+
+//  ------------------------------------------------------------------------------------------------------
+
+static void load(const char *filename)
+{
+    FILE        *fp = fopen(filename, "rb");
+    TRACEHEADER header;
+
+    if(fp == NULL)
+    {
+        perror(filename);
+        exit(1);
+    }
+    if(fread(&header, sizeof(header), 1, fp) != 1 || header.magic != TRACE_MAGIC ||
+       header.version != TRACE_VERSION || header.recordsize != sizeof(TRACEREC))
+    {
+        fprintf(stderr, "%s: not a trace file of this version and byte order\n", filename);
+        exit(1);
+    }
+    nodes = xrealloc(nodes, (nnodes + 1) * sizeof(NODE));
+    nodes[nnodes].address = header.address;
+    memcpy(nodes[nnodes].nodename, header.nodename, sizeof(header.nodename));
+    nodes[nnodes].nodename[sizeof(header.nodename) - 1] = '\0';
+    nodes[nnodes].badheaders = 0;
+    nnodes++;
+
+    for(;;)
+    {
+        if(nrecs == maxrecs)
+        {
+            maxrecs = maxrecs ? 2*maxrecs : 65536;
+            recs    = xrealloc(recs, maxrecs * sizeof(TRACEREC));
+        }
+        size_t n = fread(&recs[nrecs], sizeof(TRACEREC), maxrecs - nrecs, fp);
+        nrecs += n;
+        if(nrecs < maxrecs)
+            break;
+    }
+    fclose(fp);
+}
+
+static int by_time(const void *a, const void *b)
+{
+    int x = *(const int *)a, y = *(const int *)b;
+
+    if(recs[x].time != recs[y].time)
+        return recs[x].time < recs[y].time ? -1 : 1;
+    return x - y;
+}
+
+//  qsort IS NOT STABLE, SO AN INDEX IS SORTED INSTEAD, AND RECORDS OF THE SAME INSTANT STAY IN FILE ORDER
+static void sort_records()
+{
+    TRACEREC    *sorted = xrealloc(NULL, (nrecs + 1) * sizeof(TRACEREC));
+    int         *index = xrealloc(NULL, (nrecs + 1) * sizeof(int));
+
+    for(int i = 0; i < nrecs; i++)
+        index[i] = i;
+    qsort(index, nrecs, sizeof(int), by_time);
+    for(int i = 0; i < nrecs; i++)
+        sorted[i] = recs[index[i]];
+    free(recs);
+    free(index);
+    recs = sorted;
+}
+
+static const char *nodename(int32_t address)
+{
+    static char unknown[16];
+
+    for(int n = 0; n < nnodes; n++)
+    {
+        if(nodes[n].address == address)
+            return nodes[n].nodename;
+    }
+    snprintf(unknown, sizeof(unknown), "%i", address);
+    return unknown;
+}
+
+//  ------------------------------------------------------------------------------------------------------
+
+static unsigned int inflight_slot(int32_t source, int32_t destination, int kind, int xmit)
+{
+    uint64_t key = ((uint64_t)(uint32_t)source << 32 | (uint32_t)destination) ^ ((uint64_t)kind << 16 | xmit);
+    return (unsigned int)((key * 0x9E3779B97F4A7C15ULL) >> 32) & (inflightcap - 1);
+}
+
+//  THE ENTRY OF A TRANSMISSION, A FRESH ONE IF IT WAS NEVER SEEN
+static INFLIGHT *inflight_find(TRACEREC *r)
+{
+    if(4*(inflightused + 1) > 3*inflightcap)
+    {
+        INFLIGHT    *old = inflight;
+        int         oldcap = inflightcap;
+
+        inflightcap     = oldcap ? 2*oldcap : 65536;
+        inflight        = calloc(inflightcap, sizeof(INFLIGHT));
+        inflightused    = 0;
+        for(int i = 0; i < oldcap; i++)
+        {
+            if(old[i].used)
+            {
+                unsigned int j = inflight_slot(old[i].source, old[i].destination, old[i].kind, old[i].xmit);
+                while(inflight[j].used)
+                    j = (j + 1) & (inflightcap - 1);
+                inflight[j] = old[i];
+                inflightused++;
+            }
+        }
+        free(old);
+    }
+
+    unsigned int i = inflight_slot(r->source, r->destination, r->kind, r->xmit);
+    for(; inflight[i].used; i = (i + 1) & (inflightcap - 1))
+    {
+        INFLIGHT *f = &inflight[i];
+        if(f->source == r->source && f->destination == r->destination && f->kind == r->kind && f->xmit == r->xmit)
+            return f;
+    }
+    inflight[i].used        = true;
+    inflight[i].source      = r->source;
+    inflight[i].destination = r->destination;
+    inflight[i].kind        = r->kind;
+    inflight[i].xmit        = r->xmit;
+    inflight[i].time        = -1;
+    inflightused++;
+    return &inflight[i];
+}
+
+//  THE CONNECTION BETWEEN TWO HOSTS, OR NULL IF IT WAS NEVER SEEN
+static CONNECTION *find_connection(int32_t x, int32_t y)
+{
+    int32_t a = x < y ? x : y, b = x < y ? y : x;
+
+    for(int c = 0; c < nconns; c++)
+    {
+        if(conns[c].a == a && conns[c].b == b)
+            return &conns[c];
+    }
+    return NULL;
+}
+
+//  THE CONNECTION BETWEEN TWO HOSTS, OPENED ON FIRST SIGHT
+static CONNECTION *connection(int32_t x, int32_t y)
+{
+    int32_t     a = x < y ? x : y, b = x < y ? y : x;
+    CONNECTION  *found = find_connection(a, b);
+
+    if(found != NULL)
+        return found;
+    conns = xrealloc(conns, (nconns + 1) * sizeof(CONNECTION));
+    memset(&conns[nconns], 0, sizeof(CONNECTION));
+    conns[nconns].a = a;
+    conns[nconns].b = b;
+    return &conns[nconns++];
+}
+
+//  THE DIRECTION OF A CONNECTION A RECORD BELONGS TO, WHICH IS THAT OF THE DATA IT CONCERNS
+static DIRECTION *direction(TRACEREC *r, CONNECTION **conn)
+{
+    bool    data = r->kind != DL_ACK && r->kind != DL_NAK;
+    int32_t sender = data ? r->source : r->destination;
+
+    *conn = connection(r->source, r->destination);
+    return &(*conn)->dir[sender == (*conn)->a ? 0 : 1];
+}
+
+static bool wanted(CONNECTION *c, int32_t only[2])
+{
+    return only[0] == -1 || find_connection(only[0], only[1]) == c;
+}
+
+//  ------------------------------------------------------------------------------------------------------
+
+//  WALK THE TIMELINE ONCE, MATCHING EVERY ARRIVAL TO ITS TRANSMISSION. flight[i] IS SET TO THE TIME RECORD i
+//  SPENT IN FLIGHT, OR -1
+static void analyze(double *flight)
+{
+    for(int i = 0; i < nrecs; i++)
+    {
+        TRACEREC    *r = &recs[i];
+        CONNECTION  *c;
+        DIRECTION   *d;
+        INFLIGHT    *f;
+        int         seq = r->seq & (MAX_SEQ - 1);
+
+        flight[i] = -1;
+        if(r->event == TR_BADHEADER)
+        {
+            for(int n = 0; n < nnodes; n++)
+            {
+                if(nodes[n].address == r->node)
+                    nodes[n].badheaders++;
+            }
+            continue;
+        }
+        if(r->destination == -1 || r->kind == DL_ROUTING)
+            continue;           // routing frames go to every neighbour and belong to no connection
+        d = direction(r, &c);
+
+        switch(r->event)
+        {
+        case TR_GENERATED:  d->generated++;             break;
+        case TR_DELIVERED:  d->delivered++;             break;
+        case TR_TIMEOUT:    d->timeouts++;              break;
+        case TR_BADPAYLOAD: d->badpayloads++;           break;
+        case TR_DUPLICATE:  d->duplicates++;            break;
+        case TR_RELAYED:    d->relayed++;               break;
+
+        case TR_IGNORED:
+            if(r->kind == DL_DATA)
+                d->ignoreddata++;
+            else
+                d->ignoredacks++;
+            break;
+
+        case TR_ACKED:
+            d->acked++;
+            if(d->firstsent[seq] > 0)
+                sample(&d->sendtoack, (r->time - d->firstsent[seq]) / 1000.0);
+            break;
+
+        case TR_SENT:
+        case TR_RESENT:
+            f = inflight_find(r);
+            if(f->time == r->time)
+                break;          // the same transmission flooded to another link
+            if(f->time != -1 && !f->arrived)
+            {
+                if(r->kind == DL_DATA)
+                    d->datalost++;
+                else if(r->kind == DL_ACK)
+                    d->ackslost++;
+            }
+            f->time     = r->time;
+            f->arrived  = false;
+            if(r->kind == DL_DATA)
+            {
+                if(r->event == TR_SENT)
+                {
+                    d->datasent++;
+                    d->firstsent[seq] = r->time;
+                }
+                else
+                {
+                    d->dataresent++;
+                    sample(&d->resendgap, (r->time - d->lastsent[seq]) / 1000.0);
+                }
+                d->lastsent[seq] = r->time;
+                if(r->ack != -1)
+                    c->dir[d == &c->dir[0] ? 1 : 0].ackspiggybacked++;
+            }
+            else if(r->kind == DL_ACK)
+                d->ackssent++;
+            else
+                d->nakssent++;
+            break;
+
+        case TR_RECEIVED:
+            if(r->kind == DL_DATA)
+                d->datareceived++;
+            else if(r->kind == DL_ACK)
+                d->acksreceived++;
+            else
+                d->naksreceived++;
+            f = inflight_find(r);
+            if(f->time != -1 && !f->arrived)
+            {
+                f->arrived  = true;
+                flight[i]   = (r->time - f->time) / 1000.0;
+                sample(r->kind == DL_DATA ? &d->dataflight : &d->ackflight, flight[i]);
+            }
+            break;
+        }
+    }
+
+//  WHAT IS STILL IN FLIGHT AT THE END WAS LOST, UNLESS THE TRACE STOPPED FIRST
+    for(int i = 0; i < inflightcap; i++)
+    {
+        INFLIGHT    *f = &inflight[i];
+        TRACEREC    r;
+        CONNECTION  *c;
+
+        if(!f->used || f->arrived || f->time == -1 || f->kind == DL_NAK)
+            continue;
+        r.source        = f->source;
+        r.destination   = f->destination;
+        r.kind          = f->kind;
+        if(f->kind == DL_DATA)
+            direction(&r, &c)->datalost++;
+        else
+            direction(&r, &c)->ackslost++;
+    }
+}
+
+static void print_direction(CONNECTION *c, int dir)
+{
+    DIRECTION   *d = &c->dir[dir];
+    int32_t     from = dir == 0 ? c->a : c->b, to = dir == 0 ? c->b : c->a;
+
+    printf("%s (%i) -> %s (%i)\n", nodename(from), from, nodename(to), to);
+    printf("  messages               generated= %li, delivered= %li, acked= %li\n", d->generated, d->delivered, d->acked);
+    printf("  data frames            sent= %li, resent= %li, received= %li, never arrived= %li, timeouts= %li\n",
+           d->datasent, d->dataresent, d->datareceived, d->datalost, d->timeouts);
+    printf("  acks                   alone= %li, piggybacked= %li, received= %li, never arrived= %li\n",
+           d->ackssent, d->ackspiggybacked, d->acksreceived, d->ackslost);
+    printf("  dropped                corrupted= %li, duplicates= %li, data outside window= %li, acks acking nothing= %li\n",
+           d->badpayloads, d->duplicates, d->ignoreddata, d->ignoredacks);
+    if(d->relayed > 0)
+        printf("  relayed                %li\n", d->relayed);
+    if(d->nakssent > 0)
+        printf("  naks                   sent= %li, received= %li\n", d->nakssent, d->naksreceived);
+    print_samples("data in flight", &d->dataflight);
+    print_samples("acks in flight", &d->ackflight);
+    print_samples("between transmissions", &d->resendgap);
+    print_samples("first sent to acked", &d->sendtoack);
+}
+
+//  ------------------------------------------------------------------------------------------------------
+
+//  WHAT A FRAME IS, e.g. "DATA 1+a0" FOR DATA 1 CARRYING THE ACK OF 0
+static const char *describe(TRACEREC *r)
+{
+    static char buf[32];
+    int         n;
+
+    n = snprintf(buf, sizeof(buf), "%s", r->kind < 4 ? kindname[r->kind] : "?");
+    if(r->kind == DL_ACK)
+    {
+        n += snprintf(buf + n, sizeof(buf) - n, " %i", r->ack);
+        if(r->seq != -1)
+            snprintf(buf + n, sizeof(buf) - n, "/s%i", r->seq);
+    }
+    else if(r->seq != -1)
+    {
+        n += snprintf(buf + n, sizeof(buf) - n, " %i", r->seq);
+        if(r->ack != -1)
+            snprintf(buf + n, sizeof(buf) - n, "+a%i", r->ack);
+    }
+    return buf;
+}
+
+//  ONE LINE OF THE DIAGRAM: THE TIME, THEN THE EVENT IN THE LANE OF THE NODE THAT RECORDED IT
+static void diagram_line(TRACEREC *r, int lane, double flight)
+{
+    char    text[64];
+
+    switch(r->event)
+    {
+    case TR_GENERATED:  snprintf(text, sizeof(text), "msg %u bytes", r->length);                        break;
+    case TR_SENT:       snprintf(text, sizeof(text), "%s >l%u", describe(r), r->link);                  break;
+    case TR_RESENT:     snprintf(text, sizeof(text), "%s >>l%u resent", describe(r), r->link);          break;
+    case TR_RELAYED:    snprintf(text, sizeof(text), "%s =>l%u", describe(r), r->link);                 break;
+    case TR_DELIVERED:  snprintf(text, sizeof(text), "deliver %i", r->seq);                             break;
+    case TR_ACKED:      snprintf(text, sizeof(text), "acked %i", r->seq);                               break;
+    case TR_TIMEOUT:    snprintf(text, sizeof(text), "TIMEOUT %i", r->seq);                             break;
+    case TR_BADPAYLOAD: snprintf(text, sizeof(text), "%s <l%u CORRUPT", describe(r), r->link);          break;
+    case TR_DUPLICATE:  snprintf(text, sizeof(text), "%s <l%u dup", describe(r), r->link);              break;
+    case TR_IGNORED:    snprintf(text, sizeof(text), "%s ignored", describe(r));                        break;
+    case TR_RECEIVED:
+        if(flight >= 0)
+            snprintf(text, sizeof(text), "%s <l%u %.1fms", describe(r), r->link, flight);
+        else
+            snprintf(text, sizeof(text), "%s <l%u", describe(r), r->link);
+        break;
+    default:            snprintf(text, sizeof(text), "event %u", r->event);                             break;
+    }
+    printf("%14.3f  %*s%s\n", r->time / 1000.0, lane * LANE_WIDTH, "", text);
+}
+
+static void print_diagram(CONNECTION *c, double *flight)
+{
+    int32_t     lanes[64];
+    int         nlanes = 0;
+
+//  THE TWO HOSTS TAKE THE OUTER LANES, THE NODES BETWEEN THEM THE ONES IN THE MIDDLE IN ORDER OF APPEARANCE
+    lanes[nlanes++] = c->a;
+    for(int i = 0; i < nrecs && nlanes < 63; i++)
+    {
+        TRACEREC *r = &recs[i];
+        bool     seen = r->node == c->b;
+
+        if(r->event == TR_BADHEADER || r->destination == -1 ||
+           find_connection(r->source, r->destination) != c)
+            continue;
+        for(int l = 0; l < nlanes; l++)
+            seen |= lanes[l] == r->node;
+        if(!seen)
+            lanes[nlanes++] = r->node;
+    }
+    lanes[nlanes++] = c->b;
+
+    printf("\n== %s (%i) <-> %s (%i)\n\n%14s  ", nodename(c->a), c->a, nodename(c->b), c->b, "msec");
+    for(int l = 0; l < nlanes; l++)
+        printf("%-*.*s", LANE_WIDTH, LANE_WIDTH - 1, nodename(lanes[l]));
+    printf("\n");
+
+    for(int i = 0; i < nrecs; i++)
+    {
+        TRACEREC *r = &recs[i];
+
+        if(r->event == TR_BADHEADER || r->destination == -1 || r->kind == DL_ROUTING ||
+           find_connection(r->source, r->destination) != c)
+            continue;
+        for(int l = 0; l < nlanes; l++)
+        {
+            if(lanes[l] == r->node)
+            {
+                diagram_line(r, l, flight[i]);
+                break;
+            }
+        }
+    }
+}
+
+//  ------------------------------------------------------------------------------------------------------
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s [-d] [-c addr,addr] TRACEFILE...\n"
+                    "  -d           draw the sequence diagram of each connection\n"
+                    "  -c a,b       only the connection between addresses a and b\n", argv0);
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    bool        diagrams = false;
+    int32_t     only[2] = { -1, -1 };
+    int         opt;
+
+    while((opt = getopt(argc, argv, "dc:")) != -1)
+    {
+        switch(opt)
+        {
+        case 'd':   diagrams = true;                                break;
+        case 'c':
+            if(sscanf(optarg, "%i,%i", &only[0], &only[1]) != 2)
+                usage(argv[0]);
+            break;
+        default:    usage(argv[0]);
+        }
+    }
+    if(optind == argc)
+        usage(argv[0]);
+
+    for(int i = optind; i < argc; i++)
+        load(argv[i]);
+    sort_records();
+
+    double *flight = xrealloc(NULL, (nrecs + 1) * sizeof(double));
+    analyze(flight);
+
+    printf("%i records from %i nodes, %.3f to %.3f sec\n", nrecs, nnodes,
+           nrecs ? recs[0].time / 1e6 : 0.0, nrecs ? recs[nrecs - 1].time / 1e6 : 0.0);
+    for(int n = 0; n < nnodes; n++)
+    {
+        if(nodes[n].badheaders > 0)
+            printf("%s (%i): %li frames with a corrupted header\n", nodes[n].nodename, nodes[n].address, nodes[n].badheaders);
+    }
+    for(int c = 0; c < nconns; c++)
+    {
+        if(!wanted(&conns[c], only))
+            continue;
+        printf("\n");
+        print_direction(&conns[c], 0);
+        print_direction(&conns[c], 1);
+    }
+    if(diagrams)
+    {
+        for(int c = 0; c < nconns; c++)
+        {
+            if(wanted(&conns[c], only))
+                print_diagram(&conns[c], flight);
+        }
+    }
+    return 0;
+}